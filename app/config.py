@@ -7,7 +7,7 @@ from pathlib import Path
 from typing import Dict, Optional
 
 import yaml
-from pydantic import BaseModel, Field, ValidationError, field_validator
+from pydantic import BaseModel, Field, ValidationError, ValidationInfo, field_validator
 
 CONFIG_PATH = Path("config/config.yaml")
 CONFIG_VERSION_LOG = Path("config/config_versions.json")
@@ -19,6 +19,7 @@ class OrbitConfig(BaseModel):
     history_days: int = 14
     teme_to_ecef: str = "pymap3d"
     track_step_sec: int = 60
+    batch_transform: bool = True
 
 
 class TLEQualityConfig(BaseModel):
@@ -50,6 +51,15 @@ class FluxMockProfile(BaseModel):
     storm_altitude_km: float = 1200
     quiet_flux: float = 1.0e2
     storm_flux: float = 5.0e4
+    rng: str = "pcg64"
+    seed: int = 0
+
+    @field_validator("rng")
+    @classmethod
+    def validate_rng(cls, v: str) -> str:
+        if v not in {"pcg64", "counter"}:
+            raise ValueError("mock_profile.rng must be 'pcg64' or 'counter'")
+        return v
 
 
 class AE9AP9CLIConfig(BaseModel):
@@ -59,13 +69,29 @@ class AE9AP9CLIConfig(BaseModel):
     timeout_sec: int = 120
     cache_dir: str = "data/ae9ap9_cache"
     cache_ttl_sec: int = 86400
+    cache_format: str = "npy"
+    cache_verify: bool = True
+    cache_resume: bool = False
     time_bucket_sec: int = 3600
     max_points_per_call: int = 2000
+    workers: int = 1
+    schedule_segment_points: int = 0
+    schedule_band_km: float = 500.0
+    point_cache_enabled: bool = False
+    point_cache_quantum_deg: float = 0.01
+    point_cache_quantum_km: float = 1.0
+    point_cache_max_entries: int = 1_000_000
+    point_cache_path: str = ""
+    point_cache_save_interval_sec: int = 300
     grid_lat_step_deg: float = 2.0
     grid_lon_step_deg: float = 2.0
     grid_alt_layers_km: list[float] = Field(default_factory=lambda: [400.0, 600.0, 800.0, 1000.0])
     grid_mode: str = "2d"
     default_alt_km: float = 600.0
+    grid_table_enabled: bool = False
+    grid_lookup_rel_err: float = 0.0
+    grid_lookup_check_points: int = 64
+    grid_table_max_entries: int = 16
 
     @field_validator("output_format")
     @classmethod
@@ -74,6 +100,13 @@ class AE9AP9CLIConfig(BaseModel):
             raise ValueError("ae9ap9.output_format must be 'json' or 'csv'")
         return v
 
+    @field_validator("cache_format")
+    @classmethod
+    def validate_cache_format(cls, v: str) -> str:
+        if v not in {"npy", "json"}:
+            raise ValueError("ae9ap9.cache_format must be 'npy' or 'json'")
+        return v
+
     @field_validator("grid_mode")
     @classmethod
     def validate_grid_mode(cls, v: str) -> str:
@@ -81,6 +114,20 @@ class AE9AP9CLIConfig(BaseModel):
             raise ValueError("ae9ap9.grid_mode must be '2d' or '3d'")
         return v
 
+    @field_validator("workers")
+    @classmethod
+    def validate_workers(cls, v: int) -> int:
+        if v < 1:
+            raise ValueError("ae9ap9.workers must be >= 1")
+        return v
+
+    @field_validator("schedule_band_km")
+    @classmethod
+    def validate_schedule_band(cls, v: float) -> float:
+        if v <= 0:
+            raise ValueError("ae9ap9.schedule_band_km must be > 0")
+        return v
+
 
 class AP8AE8Config(BaseModel):
     pos_path: str = "spenvis_pos.txt"
@@ -90,6 +137,8 @@ class AP8AE8Config(BaseModel):
     grid_lat_step_deg: float = 2.0
     grid_lon_step_deg: float = 3.0
     default_alt_km: float = 550.0
+    bracket_reuse_cells: int = 1
+    compiled_cache_dir: str = "data/ap8ae8_cache"
 
 
 class FluxConfig(BaseModel):
@@ -102,6 +151,7 @@ class FluxConfig(BaseModel):
     mock_profile: FluxMockProfile = FluxMockProfile()
     ae9ap9: AE9AP9CLIConfig = Field(default_factory=AE9AP9CLIConfig)
     ap8ae8: AP8AE8Config = Field(default_factory=AP8AE8Config)
+    percentile_workers: int = 1
 
     @field_validator("model")
     @classmethod
@@ -110,6 +160,13 @@ class FluxConfig(BaseModel):
             raise ValueError("flux.model must be 'mock', 'ae9ap9', or 'ap8ae8'")
         return v
 
+    @field_validator("percentile_workers")
+    @classmethod
+    def validate_percentile_workers(cls, v: int) -> int:
+        if v < 1:
+            raise ValueError("flux.percentile_workers must be >= 1")
+        return v
+
 
 class DecisionConfig(BaseModel):
     risk_weights: Dict[str, float] = Field(
@@ -147,6 +204,55 @@ class UIConfig(BaseModel):
     risk_colorbar: Dict[str, float] = Field(default_factory=lambda: {"min": 0, "max": 6})
 
 
+class PipelineConfig(BaseModel):
+    enabled: bool = True
+    chunk_points: int = 720
+    queue_size: int = 2
+
+    @field_validator("chunk_points", "queue_size")
+    @classmethod
+    def validate_positive(cls, v: int) -> int:
+        if v < 1:
+            raise ValueError("pipeline.chunk_points and pipeline.queue_size must be >= 1")
+        return v
+
+
+class StatsConfig(BaseModel):
+    mode: str = "exact"
+    relative_accuracy: float = 0.01
+    min_value: float = 1e-10
+    max_value: float = 1e15
+
+    @field_validator("mode")
+    @classmethod
+    def validate_mode(cls, v: str) -> str:
+        if v not in {"exact", "sketch"}:
+            raise ValueError("stats.mode must be 'exact' or 'sketch'")
+        return v
+
+    @field_validator("relative_accuracy")
+    @classmethod
+    def validate_accuracy(cls, v: float) -> float:
+        if not 0.0 < v < 1.0:
+            raise ValueError("stats.relative_accuracy must be in (0, 1)")
+        return v
+
+    @field_validator("min_value")
+    @classmethod
+    def validate_min_value(cls, v: float) -> float:
+        if v <= 0.0:
+            raise ValueError("stats.min_value must be positive")
+        return v
+
+    @field_validator("max_value")
+    @classmethod
+    def validate_max_value(cls, v: float, info: ValidationInfo) -> float:
+        lo = info.data.get("min_value")
+        if lo is not None and v <= lo:
+            raise ValueError("stats.max_value must be greater than stats.min_value")
+        return v
+
+
 class CleanupConfig(BaseModel):
     enabled: bool = True
     interval_sec: int = 3600
@@ -154,6 +260,9 @@ class CleanupConfig(BaseModel):
     targets: list[str] = Field(
         default_factory=lambda: [
             "data/ae9ap9_cache/*.json",
+            "data/ae9ap9_cache/*.npy",
+            "data/ae9ap9_cache/*.npz",
+            "data/ae9ap9_cache/*.done",
             "Irene/samples/expectedOutput/*.txt",
             "Irene/samples/*Output*.txt",
         ]
@@ -166,6 +275,8 @@ class AppConfig(BaseModel):
     flux: FluxConfig = FluxConfig()
     decision: DecisionConfig = DecisionConfig()
     ui: UIConfig = UIConfig()
+    pipeline: PipelineConfig = PipelineConfig()
+    stats: StatsConfig = StatsConfig()
     cleanup: CleanupConfig = CleanupConfig()
 
     @classmethod
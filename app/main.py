@@ -7,17 +7,34 @@ import logging
 import time
 from datetime import datetime, timedelta, timezone
 from pathlib import Path
-from typing import Dict, List, Optional
+from typing import Dict, List, Optional, Tuple
 
+import numpy as np
 from dateutil import parser as dateparser
 from fastapi import Body, FastAPI, HTTPException, Response
 from fastapi.middleware.cors import CORSMiddleware
+from sgp4.api import Satrec, WGS72
 
 from app.config import AppConfig, ConfigStore, load_config
-from app.models import FluxGrid, FluxSample, ObservationPlanItem, OrbitState, TrackPoint, TLESet, Window
+from app.models import (
+    FluenceSummary,
+    FluxGrid,
+    FluxSample,
+    FluxStats,
+    ObservationPlanItem,
+    OrbitState,
+    RiskSample,
+    TrackBatchRequest,
+    TrackPoint,
+    TLESet,
+    Window,
+)
 from app.services.decision_service import DecisionService
-from app.services.flux_service import FluxService
+from app.services.export_service import FluxArchiveWriter
+from app.services.flux_service import FluxService, TrackColumns, flush_point_caches, is_resumable_segment
 from app.services.orbit_service import OrbitService
+from app.services.pipeline import staged
+from app.services.stats_service import Aggregator, BoxcarFluence, ExactAggregator, TreeReducer, make_aggregator
 from app.services.tle_service import TLEQuality, TLERepository, TLEService
 
 logging.basicConfig(level=logging.INFO, format="%(asctime)s %(levelname)s %(message)s")
@@ -82,6 +99,8 @@ def _run_cleanup(patterns: List[str], max_age_sec: int) -> None:
         for path in Path().glob(pattern):
             if not path.exists() or not path.is_file():
                 continue
+            if is_resumable_segment(config_store.config.flux.ae9ap9, path):
+                continue
             age = now - path.stat().st_mtime
             if age < max_age_sec:
                 continue
@@ -108,6 +127,7 @@ async def shutdown_event() -> None:
         _refresh_task.cancel()
     if _cleanup_task:
         _cleanup_task.cancel()
+    flush_point_caches()
 
 
 @app.get("/healthz")
@@ -121,6 +141,7 @@ async def get_config() -> Dict:
         "version": config_store.version,
         "config": config_store.config.model_dump(mode="json"),
         "flux_model": flux_service.model_name,
+        "flux_stats": flux_service.stats(),
         "history_size": len(config_store.history),
     }
 
@@ -161,8 +182,7 @@ async def sat_state(time: Optional[str] = None) -> OrbitState:
     return state
 
 
-@app.get("/sat/track", response_model=List[TrackPoint])
-async def sat_track(start: Optional[str] = None, end: Optional[str] = None, step: Optional[int] = None) -> List[TrackPoint]:
+def _track_window(start: Optional[str], end: Optional[str], step: Optional[int]) -> Tuple[datetime, datetime, datetime, int]:
     if start is None and end is None:
         now = datetime.now(timezone.utc)
         half = config_store.config.ui.track_length_sec / 2
@@ -176,12 +196,97 @@ async def sat_track(start: Optional[str] = None, end: Optional[str] = None, step
     step_sec = step or config_store.config.orbits.track_step_sec
     if end_dt <= start_dt:
         raise HTTPException(status_code=400, detail="end must be after start")
+    return start_dt, end_dt, tle_ref, step_sec
+
+
+@app.get("/sat/track", response_model=List[TrackPoint])
+async def sat_track(start: Optional[str] = None, end: Optional[str] = None, step: Optional[int] = None) -> List[TrackPoint]:
+    start_dt, end_dt, tle_ref, step_sec = _track_window(start, end, step)
     tle = await _get_best_tle(tle_ref)
     if not tle:
         raise HTTPException(status_code=503, detail="No TLE available")
     return orbit_service.track(tle, start_dt, end_dt, step_sec)
 
 
+@app.post("/sat/tracks", response_model=List[List[TrackPoint]])
+async def sat_tracks(payload: TrackBatchRequest) -> List[List[TrackPoint]]:
+    start_dt, end_dt, _, step_sec = _track_window(payload.start, payload.end, payload.step)
+    now = datetime.now(timezone.utc)
+    tles: List[TLESet] = []
+    for line1, line2 in payload.tles:
+        try:
+            sat = Satrec.twoline2rv(line1, line2, WGS72)
+        except Exception as exc:
+            raise HTTPException(status_code=400, detail=f"Invalid TLE: {exc}")
+        tles.append(
+            TLESet(
+                norad_id=sat.satnum,
+                source="request",
+                fetched_at=now,
+                epoch=TLEService._sgp4_epoch_to_datetime(sat),
+                line1=line1,
+                line2=line2,
+                score=1.0,
+            )
+        )
+    try:
+        return orbit_service.track_many(tles, start_dt, end_dt, step_sec)
+    except RuntimeError as exc:
+        raise HTTPException(status_code=400, detail=str(exc))
+
+
+async def _stream_flux(
+    start: Optional[str], end: Optional[str], step: Optional[int], percentiles: List[str], with_risk: bool
+) -> Tuple[List[TrackPoint], List[FluxSample], List[RiskSample]]:
+    """Propagate, compute flux and (optionally) risk chunk by chunk with the stages overlapped.
+
+    When with_risk is set only the risks are kept and are computed straight from the flux arrays of
+    the first percentile; no per-channel flux samples are built.
+    """
+    start_dt, end_dt, tle_ref, step_sec = _track_window(start, end, step)
+    tle = await _get_best_tle(tle_ref)
+    if not tle:
+        raise HTTPException(status_code=503, detail="No TLE available")
+    orbit, flux, decision = orbit_service, flux_service, decision_service
+    cfg = config_store.config.pipeline
+    channels = list(flux.model.channels)
+    track: List[TrackPoint] = []
+    series: List[FluxSample] = []
+    risks: List[RiskSample] = []
+    if not cfg.enabled:
+        track = orbit.track(tle, start_dt, end_dt, step_sec)
+        if with_risk:
+            values = flux.flux_values(TrackColumns.from_points(track), percentiles[0])
+            return track, [], decision.risk_samples(track, values, channels)
+        return track, flux.compute_series_many(track, percentiles), risks
+
+    chunks = orbit.iter_track(tle, start_dt, end_dt, step_sec, flux.pipeline_chunk_points(cfg.chunk_points))
+    if not with_risk:
+
+        def series_stage(chunk: List[TrackPoint]) -> Tuple[List[TrackPoint], List[FluxSample]]:
+            return chunk, flux.compute_series_many(chunk, percentiles)
+
+        # Keep the unpipelined order: every sample of one percentile before the next percentile.
+        by_percentile: Dict[str, List[FluxSample]] = {p: [] for p in percentiles}
+        for chunk, chunk_series in staged(chunks, series_stage, maxsize=cfg.queue_size):
+            track.extend(chunk)
+            for sample in chunk_series:
+                by_percentile[sample.percentile].append(sample)
+        return track, [sample for p in percentiles for sample in by_percentile[p]], risks
+
+    def flux_stage(chunk: List[TrackPoint]) -> Tuple[List[TrackPoint], np.ndarray]:
+        return chunk, flux.flux_values(TrackColumns.from_points(chunk), percentiles[0])
+
+    def risk_stage(item: Tuple[List[TrackPoint], np.ndarray]) -> Tuple[List[TrackPoint], List[RiskSample]]:
+        chunk, values = item
+        return chunk, decision.risk_samples(chunk, values, channels)
+
+    for chunk, chunk_risks in staged(chunks, flux_stage, risk_stage, maxsize=cfg.queue_size):
+        track.extend(chunk)
+        risks.extend(chunk_risks)
+    return track, series, risks
+
+
 @app.get("/env/flux/track", response_model=List[FluxSample])
 async def flux_track(
     start: Optional[str] = None,
@@ -189,10 +294,165 @@ async def flux_track(
     step: Optional[int] = None,
     percentile: Optional[str] = None,
 ) -> List[FluxSample]:
-    step_sec = step or config_store.config.orbits.track_step_sec
-    track = await sat_track(start=start, end=end, step=step_sec)
     pct = percentile or config_store.config.flux.percentile_default
-    return flux_service.compute_series(track, pct)
+    percentiles = list(dict.fromkeys(p.strip() for p in pct.split(",") if p.strip()))
+    if not percentiles:
+        raise HTTPException(status_code=400, detail="Invalid percentile")
+    _, series, _ = await _stream_flux(start, end, step, percentiles, with_risk=False)
+    return series
+
+
+@app.get("/env/flux/stats", response_model=FluxStats)
+async def flux_stats(
+    start: Optional[str] = None,
+    end: Optional[str] = None,
+    step: Optional[int] = None,
+    percentile: Optional[str] = None,
+    quantiles: str = "50,90,95,99",
+    mode: Optional[str] = None,
+) -> FluxStats:
+    """Per-channel mean and quantiles of flux along the track, aggregated chunk by chunk."""
+    try:
+        percents = [float(q) for q in quantiles.split(",") if q.strip()]
+    except ValueError:
+        raise HTTPException(status_code=400, detail="Invalid quantiles")
+    if any(not 0.0 <= q <= 100.0 for q in percents):
+        raise HTTPException(status_code=400, detail="Quantiles must be within [0, 100]")
+    stats_cfg = config_store.config.stats
+    if mode:
+        if mode not in {"exact", "sketch"}:
+            raise HTTPException(status_code=400, detail="Invalid mode")
+        stats_cfg = stats_cfg.model_copy(update={"mode": mode})
+    pct = percentile or config_store.config.flux.percentile_default
+    start_dt, end_dt, tle_ref, step_sec = _track_window(start, end, step)
+    tle = await _get_best_tle(tle_ref)
+    if not tle:
+        raise HTTPException(status_code=503, detail="No TLE available")
+    flux = flux_service
+    channels = list(flux.model.channels)
+    cfg = config_store.config.pipeline
+    chunks = orbit_service.iter_track(tle, start_dt, end_dt, step_sec, flux.pipeline_chunk_points(cfg.chunk_points))
+
+    def flux_stage(chunk: List[TrackPoint]) -> Aggregator:
+        cols = TrackColumns.from_points(chunk)
+        part = make_aggregator(stats_cfg, len(channels))
+        part.add(flux.flux_values(cols, pct), cols.t)
+        return part
+
+    reducer = TreeReducer()
+    for part in staged(chunks, flux_stage, maxsize=cfg.queue_size):
+        reducer.push(part)
+    agg = reducer.result() or make_aggregator(stats_cfg, len(channels))
+    keys = [f"{q:g}" for q in percents]
+    times: Dict[str, List[Optional[datetime]]] = {}
+    if isinstance(agg, ExactAggregator):
+        table, rows = agg.conf_levels(percents)
+        for key, row in zip(keys, agg.sample_times(rows)):
+            times[key] = _epoch_or_none(row)
+    else:
+        table = agg.quantiles(percents)
+    return FluxStats(
+        percentile=pct,
+        mode=stats_cfg.mode,
+        channels=channels,
+        count=agg.count.tolist(),
+        mean=_finite_or_none(agg.mean()),
+        quantiles={key: _finite_or_none(row) for key, row in zip(keys, table)},
+        quantile_times=times,
+    )
+
+
+@app.get("/env/flux/fluence", response_model=FluenceSummary)
+async def flux_fluence(
+    start: Optional[str] = None,
+    end: Optional[str] = None,
+    step: Optional[int] = None,
+    percentile: Optional[str] = None,
+    windows: str = "3600,86400",
+) -> FluenceSummary:
+    """Worst-to-date boxcar fluence per channel for each window length (seconds), one pass over the track."""
+    try:
+        windows_sec = [int(w) for w in windows.split(",") if w.strip()]
+    except ValueError:
+        raise HTTPException(status_code=400, detail="Invalid windows")
+    if not windows_sec or any(w <= 0 for w in windows_sec):
+        raise HTTPException(status_code=400, detail="Windows must be positive")
+    pct = percentile or config_store.config.flux.percentile_default
+    start_dt, end_dt, tle_ref, step_sec = _track_window(start, end, step)
+    tle = await _get_best_tle(tle_ref)
+    if not tle:
+        raise HTTPException(status_code=503, detail="No TLE available")
+    flux = flux_service
+    channels = list(flux.model.channels)
+    try:
+        boxcar = BoxcarFluence(len(channels), windows_sec, step_sec)
+    except ValueError as exc:
+        raise HTTPException(status_code=400, detail=str(exc))
+    cfg = config_store.config.pipeline
+    chunks = orbit_service.iter_track(tle, start_dt, end_dt, step_sec, flux.pipeline_chunk_points(cfg.chunk_points))
+
+    def flux_stage(chunk: List[TrackPoint]) -> Tuple[np.ndarray, np.ndarray]:
+        cols = TrackColumns.from_points(chunk)
+        return flux.flux_values(cols, pct), cols.t
+
+    for values, t in staged(chunks, flux_stage, maxsize=cfg.queue_size):
+        boxcar.push(values, t)
+    keys = [str(w) for w in windows_sec]
+    return FluenceSummary(
+        percentile=pct,
+        channels=channels,
+        windows_sec=windows_sec,
+        worst={key: _finite_or_none(row) for key, row in zip(keys, boxcar.worst)},
+        worst_t={key: _epoch_or_none(row) for key, row in zip(keys, boxcar.worst_t)},
+    )
+
+
+@app.get("/env/flux/export")
+async def flux_export(
+    start: Optional[str] = None,
+    end: Optional[str] = None,
+    step: Optional[int] = None,
+    percentile: Optional[str] = None,
+) -> Response:
+    """Flux along the track as a chunked, compressed columnar .npz archive (see export_service)."""
+    pct = percentile or config_store.config.flux.percentile_default
+    start_dt, end_dt, tle_ref, step_sec = _track_window(start, end, step)
+    tle = await _get_best_tle(tle_ref)
+    if not tle:
+        raise HTTPException(status_code=503, detail="No TLE available")
+    flux = flux_service
+    cfg = config_store.config.pipeline
+    output = io.BytesIO()
+    meta = {
+        "percentile": pct,
+        "flux_model": flux.model_name,
+        "norad_id": tle.norad_id,
+        "tle_epoch_utc": _to_iso_z(tle.epoch),
+        "track_step_sec": step_sec,
+    }
+    writer = FluxArchiveWriter(output, flux.model.channels, meta)
+    chunks = orbit_service.iter_track(tle, start_dt, end_dt, step_sec, flux.pipeline_chunk_points(cfg.chunk_points))
+
+    def flux_stage(chunk: List[TrackPoint]) -> Tuple[TrackColumns, np.ndarray]:
+        cols = TrackColumns.from_points(chunk)
+        return cols, flux.flux_values(cols, pct)
+
+    for cols, values in staged(chunks, flux_stage, maxsize=cfg.queue_size):
+        writer.append(cols, values)
+    writer.close()
+    return Response(
+        content=output.getvalue(),
+        media_type="application/octet-stream",
+        headers={"Content-Disposition": "attachment; filename=flux_track.npz"},
+    )
+
+
+def _finite_or_none(values) -> List[Optional[float]]:
+    return [float(v) if v == v else None for v in values]
+
+
+def _epoch_or_none(values) -> List[Optional[datetime]]:
+    return [datetime.fromtimestamp(float(v), tz=timezone.utc) if v == v else None for v in values]
 
 
 @app.get("/env/flux/grid", response_model=FluxGrid)
@@ -229,10 +489,8 @@ async def flux_grid(
 async def decision_windows(
     start: Optional[str] = None, end: Optional[str] = None, step: Optional[int] = None, percentile: Optional[str] = None
 ) -> List[Window]:
-    track = await sat_track(start=start, end=end, step=step)
     pct = percentile or config_store.config.flux.percentile_default
-    flux_series = flux_service.compute_series(track, pct)
-    risks = decision_service.compute_risk_series(flux_series)
+    track, _, risks = await _stream_flux(start, end, step, [pct], with_risk=True)
     return decision_service.decide_windows(track, risks)
 
 
@@ -308,9 +566,7 @@ async def decision_plan_export(
     end_dt = start_dt + timedelta(hours=hours)
     step_sec = step or config_store.config.orbits.track_step_sec
     pct = percentile or config_store.config.flux.percentile_default
-    track = await sat_track(start=start_dt.isoformat(), end=end_dt.isoformat(), step=step_sec)
-    flux_series = flux_service.compute_series(track, pct)
-    risks = decision_service.compute_risk_series(flux_series)
+    track, _, risks = await _stream_flux(start_dt.isoformat(), end_dt.isoformat(), step_sec, [pct], with_risk=True)
     windows = decision_service.decide_windows(track, risks)
     plan_items = _build_plan_items(start_dt, end_dt, windows)
 
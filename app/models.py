@@ -1,7 +1,7 @@
 from __future__ import annotations
 
 from datetime import datetime
-from typing import Dict, List, Literal, Optional
+from typing import Dict, List, Literal, Optional, Tuple
 
 from pydantic import BaseModel, Field
 
@@ -36,6 +36,13 @@ class TrackPoint(BaseModel):
     orbit_quality: float
 
 
+class TrackBatchRequest(BaseModel):
+    tles: List[Tuple[str, str]]
+    start: Optional[str] = None
+    end: Optional[str] = None
+    step: Optional[int] = None
+
+
 class FluxSample(BaseModel):
     t: datetime
     channel: str
@@ -43,6 +50,24 @@ class FluxSample(BaseModel):
     percentile: str
 
 
+class FluxStats(BaseModel):
+    percentile: str
+    mode: str
+    channels: List[str]
+    count: List[int]
+    mean: List[Optional[float]]
+    quantiles: Dict[str, List[Optional[float]]]
+    quantile_times: Dict[str, List[Optional[datetime]]] = Field(default_factory=dict)
+
+
+class FluenceSummary(BaseModel):
+    percentile: str
+    channels: List[str]
+    windows_sec: List[int]
+    worst: Dict[str, List[Optional[float]]]
+    worst_t: Dict[str, List[Optional[datetime]]]
+
+
 class FluxGrid(BaseModel):
     t: datetime
     channel: str
@@ -1,7 +1,9 @@
 from __future__ import annotations
 
 from datetime import datetime, timedelta
-from typing import Dict, List
+from typing import Dict, List, Tuple
+
+import numpy as np
 
 from app.config import DecisionConfig
 from app.models import FluxSample, RiskSample, TrackPoint, Window
@@ -10,23 +12,45 @@ from app.models import FluxSample, RiskSample, TrackPoint, Window
 class DecisionService:
     def __init__(self, cfg: DecisionConfig):
         self.cfg = cfg
+        self._weights: Dict[Tuple[str, ...], np.ndarray] = {}
 
     def compute_risk_series(self, flux_series: List[FluxSample]) -> List[RiskSample]:
-        by_time: Dict[datetime, Dict[str, float]] = {}
+        times: Dict[datetime, int] = {}
+        channels: Dict[str, int] = {}
         for sample in flux_series:
-            by_time.setdefault(sample.t, {})[sample.channel] = sample.value
-
-        risks: List[RiskSample] = []
-        for t, channels in sorted(by_time.items()):
-            risk_val = 0.0
-            for ch, val in channels.items():
-                weight = self.cfg.risk_weights.get(ch, 0.0)
-                if val <= 0:
-                    continue
-                risk_val += weight * (val ** self.cfg.risk_exponent)
-            risk_val *= self.cfg.risk_scale
-            risks.append(RiskSample(t=t, risk=risk_val))
-        return risks
+            times.setdefault(sample.t, len(times))
+            channels.setdefault(sample.channel, len(channels))
+        values = np.full((len(times), len(channels)), np.nan)
+        for sample in flux_series:
+            values[times[sample.t], channels[sample.channel]] = sample.value
+
+        risk = self.compute_risk_array(values, list(channels))
+        return [RiskSample(t=t, risk=float(risk[row])) for t, row in sorted(times.items())]
+
+    def compute_risk_array(self, values: np.ndarray, channels: List[str]) -> np.ndarray:
+        """Risk per row of a [time x channel] flux matrix; NaN and non-positive flux contribute nothing.
+
+        The response is linear in flux**risk_exponent, so the whole series is one matrix-vector product.
+        """
+        values = np.asarray(values, dtype=float)
+        powered = np.zeros_like(values)
+        positive = values > 0
+        powered[positive] = values[positive] ** self.cfg.risk_exponent
+        return (powered @ self._weight_vector(tuple(channels))) * self.cfg.risk_scale
+
+    def risk_samples(self, track: List[TrackPoint], values: np.ndarray, channels: List[str]) -> List[RiskSample]:
+        """Risk samples for a track and its [point x channel] flux; points with no flux at all are skipped."""
+        values = np.asarray(values, dtype=float)
+        risk = self.compute_risk_array(values, channels)
+        present = ~np.isnan(values).all(axis=1)
+        return [RiskSample(t=pt.t, risk=float(r)) for pt, r, ok in zip(track, risk, present) if ok]
+
+    def _weight_vector(self, channels: Tuple[str, ...]) -> np.ndarray:
+        weights = self._weights.get(channels)
+        if weights is None:
+            weights = np.array([self.cfg.risk_weights.get(ch, 0.0) for ch in channels], dtype=float)
+            self._weights[channels] = weights
+        return weights
 
     def decide_windows(self, track: List[TrackPoint], risks: List[RiskSample]) -> List[Window]:
         windows: List[Window] = []
@@ -0,0 +1,68 @@
+from __future__ import annotations
+
+import io
+import json
+import zipfile
+from typing import BinaryIO, Dict, List, Optional
+
+import numpy as np
+
+from app.services.flux_service import TrackColumns
+
+
+class FluxArchiveWriter:
+    """Writes flux along a track as a chunked, compressed columnar .npz archive.
+
+    Every appended chunk becomes its own deflated members (t, lat, lon, alt_km and one flux
+    column per channel), and index.npy lists [first row, t_start, t_end] per chunk. np.load
+    opens the archive lazily, so readers decompress only the chunks and channels they ask for.
+    """
+
+    def __init__(self, fileobj: BinaryIO, channels: List[str], meta: Optional[Dict] = None):
+        self.channels = list(channels)
+        self._zip = zipfile.ZipFile(fileobj, mode="w", compression=zipfile.ZIP_DEFLATED)
+        self._index: List[List[float]] = []
+        self._rows = 0
+        self._write("channels", np.array(self.channels))
+        self._zip.writestr("meta.json", json.dumps(meta or {}))
+
+    def append(self, cols: TrackColumns, values: np.ndarray) -> None:
+        if len(cols) == 0:
+            return
+        k = len(self._index)
+        for name in ("t", "lat", "lon", "alt_km"):
+            self._write(f"{name}_{k:05d}", np.asarray(getattr(cols, name), dtype=float))
+        values = np.asarray(values, dtype=float)
+        for j in range(len(self.channels)):
+            self._write(f"flux{j}_{k:05d}", values[:, j])
+        self._index.append([float(self._rows), float(cols.t[0]), float(cols.t[-1])])
+        self._rows += len(cols)
+
+    def close(self) -> None:
+        self._write("index", np.array(self._index, dtype=float).reshape(-1, 3))
+        self._zip.close()
+
+    def _write(self, name: str, arr: np.ndarray) -> None:
+        buf = io.BytesIO()
+        np.lib.format.write_array(buf, arr, allow_pickle=False)
+        self._zip.writestr(f"{name}.npy", buf.getvalue())
+
+
+def read_flux_window(
+    source, t_start: float, t_end: float, channels: Optional[List[str]] = None
+) -> Dict[str, np.ndarray]:
+    """Rows with t_start <= t <= t_end (epoch seconds), touching only the overlapping chunks."""
+    with np.load(source, allow_pickle=False) as archive:
+        names = archive["channels"].tolist()
+        wanted = names if channels is None else channels
+        index = archive["index"]
+        parts: Dict[str, List[np.ndarray]] = {name: [] for name in ["t", "lat", "lon", "alt_km", *wanted]}
+        for k in np.flatnonzero((index[:, 2] >= t_start) & (index[:, 1] <= t_end)):
+            t = archive[f"t_{k:05d}"]
+            keep = (t >= t_start) & (t <= t_end)
+            parts["t"].append(t[keep])
+            for name in ("lat", "lon", "alt_km"):
+                parts[name].append(archive[f"{name}_{k:05d}"][keep])
+            for ch in wanted:
+                parts[ch].append(archive[f"flux{names.index(ch)}_{k:05d}"][keep])
+    return {name: np.concatenate(chunks) if chunks else np.empty(0) for name, chunks in parts.items()}
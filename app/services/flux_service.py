@@ -1,71 +1,446 @@
 from __future__ import annotations
 
+import bisect
 import hashlib
+import io
 import json
+import logging
 import subprocess
 import tempfile
+import threading
+import time
+from collections import OrderedDict, deque
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass
 from datetime import datetime, timezone
 from pathlib import Path
-from typing import Dict, List, Tuple
+from typing import Deque, Dict, List, Tuple
 
 import numpy as np
 
 from app.config import AE9AP9CLIConfig, AP8AE8Config, FluxConfig, FluxMockProfile
 from app.models import FluxSample, TrackPoint
 
+logger = logging.getLogger("mass-cube")
+
+
+@dataclass
+class TrackColumns:
+    """Struct-of-arrays view of a track: epoch seconds (UTC), lat/lon in degrees, altitude in km."""
+
+    t: np.ndarray
+    lat: np.ndarray
+    lon: np.ndarray
+    alt_km: np.ndarray
+
+    @classmethod
+    def from_points(cls, points: List[TrackPoint]) -> "TrackColumns":
+        n = len(points)
+        cols = cls(t=np.empty(n), lat=np.empty(n), lon=np.empty(n), alt_km=np.empty(n))
+        for i, p in enumerate(points):
+            cols.t[i] = p.t.timestamp()
+            cols.lat[i] = p.lat
+            cols.lon[i] = p.lon
+            cols.alt_km[i] = p.alt_km
+        return cols
+
+    def __len__(self) -> int:
+        return len(self.t)
+
+    def slice(self, start: int, stop: int) -> "TrackColumns":
+        return TrackColumns(
+            t=self.t[start:stop],
+            lat=self.lat[start:stop],
+            lon=self.lon[start:stop],
+            alt_km=self.alt_km[start:stop],
+        )
+
+    def take(self, idx: np.ndarray) -> "TrackColumns":
+        return TrackColumns(t=self.t[idx], lat=self.lat[idx], lon=self.lon[idx], alt_km=self.alt_km[idx])
+
 
 class FluxModel:
+    channels: List[str] = []
+
     def flux(self, point: TrackPoint, percentile: str) -> Dict[str, float]:
         raise NotImplementedError
 
+    def flux_into(self, cols: TrackColumns, percentile: str, out: np.ndarray) -> None:
+        """Fill the caller-owned [point x channel] buffer; channels missing from the model output are NaN."""
+        for i in range(len(cols)):
+            point = TrackPoint(
+                t=datetime.fromtimestamp(float(cols.t[i]), tz=timezone.utc),
+                lat=float(cols.lat[i]),
+                lon=float(cols.lon[i]),
+                alt_km=float(cols.alt_km[i]),
+                tle_epoch=datetime.fromtimestamp(float(cols.t[i]), tz=timezone.utc),
+                orbit_quality=1.0,
+            )
+            values = self.flux(point, percentile)
+            for j, ch in enumerate(self.channels):
+                out[i, j] = values.get(ch, np.nan)
+
+    def flux_array(self, cols: TrackColumns, percentile: str) -> np.ndarray:
+        out = np.empty((len(cols), len(self.channels)), dtype=float)
+        self.flux_into(cols, percentile, out)
+        return out
+
     def flux_batch(self, points: List[TrackPoint], percentile: str) -> List[Dict[str, float]]:
-        return [self.flux(pt, percentile) for pt in points]
+        values = self.flux_array(TrackColumns.from_points(points), percentile)
+        return [
+            {ch: float(v) for ch, v in zip(self.channels, row) if not np.isnan(v)}
+            for row in values
+        ]
 
 
 class MockFluxModel(FluxModel):
+    channels = ["Je>100keV", "Je>1MeV", "Jp>10MeV", "Jp>50MeV"]
+    channel_scale = np.array([1.0, 0.5, 0.2, 0.05])
+
     def __init__(self, profile: FluxMockProfile):
         self.profile = profile
 
     def flux(self, point: TrackPoint, percentile: str) -> Dict[str, float]:
-        alt = point.alt_km
+        base = self._base(point.alt_km)
+        noise = self._noise(point.t.timestamp())
+        return {ch: base * scale * noise for ch, scale in zip(self.channels, self.channel_scale)}
+
+    def flux_into(self, cols: TrackColumns, percentile: str, out: np.ndarray) -> None:
+        np.multiply(self._base(cols.alt_km)[:, None], self.channel_scale[None, :], out=out)
+        out *= self._noise_array(cols.t)[:, None]
+
+    def _base(self, alt: float) -> float:
         frac = np.clip((alt - self.profile.quiet_altitude_km) / (self.profile.storm_altitude_km - self.profile.quiet_altitude_km), 0.0, 1.0)
-        base = self.profile.quiet_flux + frac * (self.profile.storm_flux - self.profile.quiet_flux)
-        noise = np.random.default_rng(seed=int(point.t.timestamp())).normal(1.0, 0.05)
-        return {
-            "Je>100keV": base * noise,
-            "Je>1MeV": base * 0.5 * noise,
-            "Jp>10MeV": base * 0.2 * noise,
-            "Jp>50MeV": base * 0.05 * noise,
-        }
+        return self.profile.quiet_flux + frac * (self.profile.storm_flux - self.profile.quiet_flux)
+
+    def _noise(self, timestamp: float) -> float:
+        return float(self._noise_array(np.array([timestamp]))[0])
+
+    def _noise_array(self, timestamps: np.ndarray) -> np.ndarray:
+        if self.profile.rng == "counter":
+            return counter_normal(self.profile.seed, timestamps) * 0.05 + 1.0
+        # PCG64 streams are seeded per second, so only distinct seconds need a generator.
+        seconds, inverse = np.unique(np.asarray(timestamps, dtype=float).astype(np.int64), return_inverse=True)
+        draws = np.array([np.random.default_rng(seed=int(sec)).normal(1.0, 0.05) for sec in seconds])
+        return draws[inverse.reshape(-1)]
+
+
+def _splitmix64(x: np.ndarray) -> np.ndarray:
+    x = x + np.uint64(0x9E3779B97F4A7C15)
+    x = (x ^ (x >> np.uint64(30))) * np.uint64(0xBF58476D1CE4E5B9)
+    x = (x ^ (x >> np.uint64(27))) * np.uint64(0x94D049BB133111EB)
+    return x ^ (x >> np.uint64(31))
+
+
+def counter_normal(seed: int, counters: np.ndarray) -> np.ndarray:
+    """Standard normal draws keyed only on (seed, int(counter)), vectorized over counters.
+
+    Each draw is a stateless hash of its key (splitmix64 finalizer + Box-Muller), so any
+    thread can produce any timestamp's value independently, in any order or chunking.
+    """
+    with np.errstate(over="ignore"):
+        key = _splitmix64(np.array([seed], dtype=np.int64).view(np.uint64))
+        ctr = np.asarray(counters, dtype=float).astype(np.int64).view(np.uint64)
+        base = _splitmix64(ctr ^ key) << np.uint64(1)
+        u1 = (_splitmix64(base) >> np.uint64(11)).astype(float) * 2.0**-53
+        u2 = (_splitmix64(base + np.uint64(1)) >> np.uint64(11)).astype(float) * 2.0**-53
+    return np.sqrt(-2.0 * np.log1p(-u1)) * np.cos(2.0 * np.pi * u2)
+
+
+class PointFluxCache:
+    """Per-point flux memo keyed on (time bucket, quantized position, percentile, channel).
+
+    Instances are shared process-wide through point_cache_for(), so repeated passes over the
+    same orbit (track, windows, plan export, config rebuilds) skip the CLI for known points.
+    Entries expire after ttl_sec. The optional file is written at most every save_interval_sec
+    and on flush(), and is ignored when it was produced by a different CLI signature.
+    """
+
+    def __init__(
+        self,
+        bucket_sec: int,
+        quantum_deg: float,
+        quantum_km: float,
+        max_entries: int,
+        path: str = "",
+        ttl_sec: int = 0,
+        signature: str = "",
+        save_interval_sec: int = 300,
+    ):
+        self.bucket_sec = bucket_sec
+        self.quantum_deg = quantum_deg
+        self.quantum_km = quantum_km
+        self.max_entries = max_entries
+        self.path = Path(path) if path else None
+        self.ttl_sec = ttl_sec
+        self.signature = signature
+        self.save_interval_sec = save_interval_sec
+        self._entries: "OrderedDict[Tuple, Tuple[float, float]]" = OrderedDict()
+        self._lock = threading.Lock()
+        self._dirty = False
+        self._saved_at = time.time()
+        self._load()
+
+    def point_keys(self, cols: TrackColumns) -> List[Tuple]:
+        t = cols.t if self.bucket_sec <= 0 else np.floor(cols.t / self.bucket_sec) * self.bucket_sec
+        lat = self._quantize(cols.lat, self.quantum_deg)
+        lon = self._quantize(cols.lon, self.quantum_deg)
+        alt = self._quantize(cols.alt_km, self.quantum_km)
+        return list(zip(t.tolist(), lat.tolist(), lon.tolist(), alt.tolist()))
+
+    def lookup(self, keys: List[Tuple], percentile: str, channels: List[str], out: np.ndarray) -> np.ndarray:
+        hits = np.zeros(len(keys), dtype=bool)
+        oldest = time.time() - self.ttl_sec if self.ttl_sec > 0 else float("-inf")
+        with self._lock:
+            for i, key in enumerate(keys):
+                row = [self._entries.get(key + (percentile, ch)) for ch in channels]
+                if any(v is None or v[1] < oldest for v in row):
+                    continue
+                for key_ch in channels:
+                    self._entries.move_to_end(key + (percentile, key_ch))
+                out[i, :] = [v[0] for v in row]
+                hits[i] = True
+        return hits
+
+    def store(self, keys: List[Tuple], percentile: str, channels: List[str], values: np.ndarray) -> None:
+        now = time.time()
+        with self._lock:
+            for key, row in zip(keys, values):
+                for ch, val in zip(channels, row.tolist()):
+                    self._entries[key + (percentile, ch)] = (val, now)
+                    self._entries.move_to_end(key + (percentile, ch))
+            while len(self._entries) > self.max_entries:
+                self._entries.popitem(last=False)
+            self._dirty = True
+            due = self.path is not None and now - self._saved_at >= self.save_interval_sec
+        if due:
+            self.flush()
+
+    def flush(self) -> None:
+        """Write the file now if anything changed since the last write."""
+        if self.path is None:
+            return
+        with self._lock:
+            if not self._dirty:
+                return
+            entries = [list(key) + list(val) for key, val in self._entries.items()]
+            self._dirty = False
+            self._saved_at = time.time()
+        payload = json.dumps({"signature": self.signature, "entries": entries})
+        _atomic_write_bytes(self.path, payload.encode("utf-8"))
+
+    def _load(self) -> None:
+        if self.path is None or not self.path.exists():
+            return
+        data = json.loads(self.path.read_text(encoding="utf-8"))
+        if data.get("signature") != self.signature:
+            return
+        for entry in data.get("entries", []):
+            self._entries[tuple(entry[:-2])] = (entry[-2], entry[-1])
+
+    @staticmethod
+    def _quantize(values: np.ndarray, quantum: float) -> np.ndarray:
+        if quantum <= 0:
+            return values
+        return np.round(values / quantum) * quantum
+
+
+def _atomic_write_bytes(path: Path, data: bytes) -> None:
+    """Write through a uniquely named temp file in the same directory, then rename over path.
+
+    Concurrent writers (threads or processes) never share a temp file; the last rename wins.
+    """
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with tempfile.NamedTemporaryFile(dir=path.parent, prefix=path.name + ".", suffix=".tmp", delete=False) as f:
+        f.write(data)
+    Path(f.name).replace(path)
+
+
+def cli_signature(cfg: AE9AP9CLIConfig) -> str:
+    """Identifies the CLI producing the values: executable (and its mtime), command template, output format."""
+    exe = Path(cfg.executable) if cfg.executable else None
+    mtime = exe.stat().st_mtime_ns if exe is not None and exe.is_file() else None
+    raw = json.dumps([cfg.executable, mtime, cfg.command_template, cfg.output_format])
+    return hashlib.sha256(raw.encode("utf-8")).hexdigest()[:16]
+
+
+_point_caches: Dict[Tuple, PointFluxCache] = {}
+_point_caches_lock = threading.Lock()
+
+
+def point_cache_for(cfg: AE9AP9CLIConfig) -> PointFluxCache | None:
+    if not cfg.point_cache_enabled:
+        return None
+    key = (
+        cfg.time_bucket_sec,
+        cfg.point_cache_quantum_deg,
+        cfg.point_cache_quantum_km,
+        cfg.point_cache_max_entries,
+        cfg.point_cache_path,
+        cfg.cache_ttl_sec,
+        cli_signature(cfg),
+        cfg.point_cache_save_interval_sec,
+    )
+    with _point_caches_lock:
+        if key not in _point_caches:
+            stale = [k for k, cache in _point_caches.items() if cfg.point_cache_path and k[4] == cfg.point_cache_path]
+            for k in stale:
+                _point_caches.pop(k).flush()
+            _point_caches[key] = PointFluxCache(*key)
+        return _point_caches[key]
+
+
+def flush_point_caches() -> None:
+    with _point_caches_lock:
+        caches = list(_point_caches.values())
+    for cache in caches:
+        cache.flush()
+
+
+def is_resumable_segment(cfg: AE9AP9CLIConfig, path: Path) -> bool:
+    """True for a completed binary segment (or its record) that cache_resume must keep on disk."""
+    if not cfg.cache_resume or path.suffix not in (".npy", ".done"):
+        return False
+    if path.resolve().parent != Path(cfg.cache_dir).resolve():
+        return False
+    return path.with_suffix(".done").exists()
+
+
+class SegmentCostModel:
+    """Seconds-per-point estimates by altitude band, learned from finished CLI segments.
+
+    Bands never timed fall back to the mean known rate (1.0 before anything is known), so the
+    first run schedules by size and later runs by observed cost.
+    """
+
+    def __init__(self, band_km: float, recent: int = 256):
+        self.band_km = band_km
+        self.timings: Deque[Dict] = deque(maxlen=recent)
+        self._rate: Dict[int, float] = {}
+        self._lock = threading.Lock()
+
+    def estimate(self, alt_km: np.ndarray) -> float:
+        bands, counts = np.unique(np.floor(alt_km / self.band_km).astype(np.int64), return_counts=True)
+        with self._lock:
+            default = float(np.mean(list(self._rate.values()))) if self._rate else 1.0
+            return float(sum(self._rate.get(int(b), default) * int(c) for b, c in zip(bands, counts)))
+
+    def observe(self, alt_km: np.ndarray, seconds: float, estimate: float) -> None:
+        if len(alt_km) == 0:
+            return
+        rate = seconds / len(alt_km)
+        with self._lock:
+            for band in np.unique(np.floor(alt_km / self.band_km).astype(np.int64)).tolist():
+                old = self._rate.get(band)
+                self._rate[band] = rate if old is None else 0.7 * old + 0.3 * rate
+            self.timings.append({"points": len(alt_km), "estimate": estimate, "seconds": seconds})
 
 
 class AE9AP9Model(FluxModel):
     def __init__(self, cfg: AE9AP9CLIConfig, channels: List[str]):
         self.cfg = cfg
         self.channels = channels
+        self.point_cache = point_cache_for(cfg)
+        self.cost_model = SegmentCostModel(cfg.schedule_band_km)
 
     def flux(self, point: TrackPoint, percentile: str) -> Dict[str, float]:
         return self.flux_batch([point], percentile)[0]
 
-    def flux_batch(self, points: List[TrackPoint], percentile: str) -> List[Dict[str, float]]:
+    def flux_into(self, cols: TrackColumns, percentile: str, out: np.ndarray) -> None:
         if not self.cfg.executable or not self.cfg.command_template:
             raise RuntimeError("AE9/AP9 CLI not configured: set flux.ae9ap9.executable and command_template")
+        if self.point_cache is None:
+            self._evaluate(cols, percentile, out)
+            return
+        keys = self.point_cache.point_keys(cols)
+        hits = self.point_cache.lookup(keys, percentile, self.channels, out)
+        missing = np.flatnonzero(~hits)
+        if len(missing) == 0:
+            return
+        values = np.empty((len(missing), len(self.channels)), dtype=float)
+        self._evaluate(cols.take(missing), percentile, values)
+        out[missing] = values
+        self.point_cache.store([keys[i] for i in missing], percentile, self.channels, values)
+
+    def _evaluate(self, cols: TrackColumns, percentile: str, out: np.ndarray) -> None:
+        max_points = self.cfg.max_points_per_call if self.cfg.max_points_per_call > 0 else 2000
+        chunks = [(i, min(i + max_points, len(cols))) for i in range(0, len(cols), max_points)]
+        # Each chunk writes a disjoint slice of out, so results do not depend on the worker count.
+        if self.cfg.workers > 1 and self.cfg.schedule_segment_points > 0:
+            segment_points = min(self.cfg.schedule_segment_points, max_points)
+            if len(cols) > segment_points:
+                self._evaluate_scheduled(cols, percentile, out, segment_points)
+                return
+        if self.cfg.workers <= 1 or len(chunks) <= 1:
+            for start, stop in chunks:
+                self._flux_chunk(cols.slice(start, stop), percentile, out[start:stop])
+            return
+        with ThreadPoolExecutor(max_workers=min(self.cfg.workers, len(chunks))) as pool:
+            futures = [
+                pool.submit(self._flux_chunk, cols.slice(start, stop), percentile, out[start:stop])
+                for start, stop in chunks
+            ]
+            for future in futures:
+                future.result()
+
+    def _evaluate_scheduled(self, cols: TrackColumns, percentile: str, out: np.ndarray, segment_points: int) -> None:
+        """Small segments queued most expensive first; idle workers pull the next one from the pool queue."""
+        segments = []
+        for start in range(0, len(cols), segment_points):
+            stop = min(start + segment_points, len(cols))
+            segments.append((self.cost_model.estimate(cols.alt_km[start:stop]), start, stop))
+        segments.sort(key=lambda seg: -seg[0])
+        with ThreadPoolExecutor(max_workers=min(self.cfg.workers, len(segments))) as pool:
+            futures = [
+                pool.submit(self._timed_chunk, cols.slice(start, stop), percentile, out[start:stop], estimate)
+                for estimate, start, stop in segments
+            ]
+            for future in futures:
+                future.result()
+
+    def _timed_chunk(self, cols: TrackColumns, percentile: str, out: np.ndarray, estimate: float) -> None:
+        started = time.perf_counter()
+        if not self._flux_chunk(cols, percentile, out):
+            return  # a cache hit says nothing about how expensive the band is to compute
+        seconds = time.perf_counter() - started
+        self.cost_model.observe(cols.alt_km, seconds, estimate)
+        logger.debug("ae9ap9 segment: %d points, estimated cost %.3g, %.3f s", len(cols), estimate, seconds)
+
+    def schedule_stats(self) -> List[Dict]:
+        return list(self.cost_model.timings)
+
+    def _flux_chunk(self, cols: TrackColumns, percentile: str, out: np.ndarray) -> bool:
+        """Fill out for one chunk; True when the CLI actually ran, False on a cache hit."""
         payload = {
             "percentile": percentile,
             "channels": self.channels,
             "points": [
-                {"lat": p.lat, "lon": p.lon, "alt_km": p.alt_km, "time": p.t.astimezone(timezone.utc).isoformat()}
-                for p in points
+                {
+                    "lat": float(cols.lat[i]),
+                    "lon": float(cols.lon[i]),
+                    "alt_km": float(cols.alt_km[i]),
+                    "time": datetime.fromtimestamp(float(cols.t[i]), tz=timezone.utc).isoformat(),
+                }
+                for i in range(len(cols))
             ],
         }
-        data = self._run_cli(payload)
-        return self._parse_output(data, len(points))
-
-    def _run_cli(self, payload: Dict) -> Dict:
+        binary = self.cfg.cache_format == "npy"
         cache_key = self._cache_key(payload)
-        cached = self._read_cache(cache_key)
-        if cached is not None:
-            return cached
+        if binary and self._read_array_cache(cache_key, out):
+            return False
+        # With the binary format, a JSON entry from an older run is parsed once more and then kept in binary form.
+        data = self._read_cache(cache_key)
+        ran = data is None
+        if ran:
+            data = self._invoke_cli(payload)
+        self._parse_output(data, out)
+        if binary:
+            self._write_array_cache(cache_key, out)
+        elif ran:
+            self._write_cache(cache_key, data)
+        return ran
+
+    def _invoke_cli(self, payload: Dict) -> Dict:
         with tempfile.TemporaryDirectory() as tmpdir:
             input_path = Path(tmpdir) / "input.json"
             output_path = Path(tmpdir) / "output.json"
@@ -78,87 +453,291 @@ class AE9AP9Model(FluxModel):
                 data = json.loads(output_path.read_text(encoding="utf-8"))
             else:
                 data = {"csv": output_path.read_text(encoding="utf-8")}
-        self._write_cache(cache_key, data)
         return data
 
-    def _parse_output(self, data: Dict, n_points: int) -> List[Dict[str, float]]:
+    def _parse_output(self, data: Dict, out: np.ndarray) -> None:
+        out.fill(np.nan)
         if "points" in data:
-            values = []
-            for item in data["points"]:
-                values.append(item.get("values", {}))
-            if len(values) != n_points:
+            if len(data["points"]) != len(out):
                 raise RuntimeError("IRENE output points count mismatch")
-            return values
+            for i, item in enumerate(data["points"]):
+                values = item.get("values", {})
+                for j, ch in enumerate(self.channels):
+                    if ch in values:
+                        out[i, j] = values[ch]
+            return
         if "csv" in data:
-            return self._parse_csv(data["csv"], n_points)
+            self._parse_csv(data["csv"], out)
+            return
         raise RuntimeError("IRENE output format not recognized")
 
-    def _parse_csv(self, csv_text: str, n_points: int) -> List[Dict[str, float]]:
-        values = [dict() for _ in range(n_points)]
+    def _parse_csv(self, csv_text: str, out: np.ndarray) -> None:
+        column = {ch: j for j, ch in enumerate(self.channels)}
         for line in csv_text.splitlines():
             parts = [p.strip() for p in line.split(",")]
             if len(parts) < 3:
                 continue
             idx = int(parts[0])
-            channel = parts[1]
-            val = float(parts[2])
-            if 0 <= idx < n_points:
-                values[idx][channel] = val
-        return values
+            j = column.get(parts[1])
+            if j is not None and 0 <= idx < len(out):
+                out[idx, j] = float(parts[2])
 
     def _cache_key(self, payload: Dict) -> str:
         raw = json.dumps(payload, sort_keys=True).encode("utf-8")
         return hashlib.sha256(raw).hexdigest()
 
     def _read_cache(self, key: str) -> Dict | None:
+        path = Path(self.cfg.cache_dir) / f"{key}.json"
+        if not self._is_fresh(path):
+            return None
+        return json.loads(path.read_text(encoding="utf-8"))
+
+    def _read_array_cache(self, key: str, out: np.ndarray) -> bool:
+        """Fill out from a completed binary segment; False when missing, stale, mis-shaped or corrupt.
+
+        A segment counts as completed only when its {key}.done record exists; a .npy without one
+        is a plain miss, since another writer may be between its two renames. An unreadable
+        segment or, with cache_verify, a sha256 mismatch is removed and re-run.
+        Without cache_verify the segment is memory-mapped instead of read whole. cache_resume
+        skips the cache_ttl_sec check, and the cleanup loop leaves completed segments alone.
+        """
         cache_dir = Path(self.cfg.cache_dir)
-        cache_dir.mkdir(parents=True, exist_ok=True)
-        path = cache_dir / f"{key}.json"
+        path = cache_dir / f"{key}.npy"
+        done = cache_dir / f"{key}.done"
+        if not path.exists() or not done.exists():
+            return False
+        if not self.cfg.cache_resume and not self._is_fresh(path):
+            return False
+        try:
+            text = done.read_text(encoding="utf-8")
+        except FileNotFoundError:
+            return False
+        try:
+            record = json.loads(text)
+            if self.cfg.cache_verify:
+                raw = path.read_bytes()
+                if hashlib.sha256(raw).hexdigest() != record["sha256"]:
+                    raise ValueError("checksum mismatch")
+                values = np.load(io.BytesIO(raw))
+            else:
+                values = np.load(path, mmap_mode="r")
+        except (OSError, EOFError, ValueError, KeyError):
+            logger.warning("ae9ap9 cache segment %s is incomplete or corrupt; re-running it", key)
+            path.unlink(missing_ok=True)
+            done.unlink(missing_ok=True)
+            return False
+        if values.shape != out.shape:
+            return False
+        out[:] = values
+        return True
+
+    def _write_array_cache(self, key: str, values: np.ndarray) -> None:
+        """Write the segment, then its completion record; a crash in between leaves it to be re-run."""
+        cache_dir = Path(self.cfg.cache_dir)
+        buf = io.BytesIO()
+        np.save(buf, np.ascontiguousarray(values, dtype=float))
+        raw = buf.getvalue()
+        record = {
+            "sha256": hashlib.sha256(raw).hexdigest(),
+            "shape": list(values.shape),
+            "completed_at": datetime.now(timezone.utc).isoformat(),
+        }
+        for path, data in ((cache_dir / f"{key}.npy", raw), (cache_dir / f"{key}.done", json.dumps(record).encode("utf-8"))):
+            _atomic_write_bytes(path, data)
+
+    def _is_fresh(self, path: Path) -> bool:
         if not path.exists():
-            return None
+            return False
         age = datetime.now(timezone.utc).timestamp() - path.stat().st_mtime
-        if age > self.cfg.cache_ttl_sec:
-            return None
-        return json.loads(path.read_text(encoding="utf-8"))
+        return age <= self.cfg.cache_ttl_sec
 
     def _write_cache(self, key: str, data: Dict) -> None:
-        cache_dir = Path(self.cfg.cache_dir)
-        cache_dir.mkdir(parents=True, exist_ok=True)
-        path = cache_dir / f"{key}.json"
-        path.write_text(json.dumps(data), encoding="utf-8")
+        _atomic_write_bytes(Path(self.cfg.cache_dir) / f"{key}.json", json.dumps(data).encode("utf-8"))
+
+
+class GridAxis:
+    """Sorted 1-D grid axis whose bracket search is seeded from the previous query.
+
+    Consecutive track points usually fall in the same or a neighbouring cell, so the
+    previous bracket is checked first and the binary search only runs when the query
+    drifted more than reuse_cells away.
+    """
+
+    def __init__(self, nodes: List[float], reuse_cells: int):
+        self.nodes = [float(x) for x in nodes]
+        self._nodes = np.asarray(self.nodes, dtype=float)
+        self.reuse_cells = reuse_cells
+        self.hits = 0
+        self.misses = 0
+        self.searched = 0
+        self._last: int | None = None
+
+    def locate(self, x: float) -> int:
+        """Return the index of the first node greater than x (numpy searchsorted side="right")."""
+        nodes = self.nodes
+        i1 = self._last
+        if i1 is not None:
+            for _ in range(self.reuse_cells + 1):
+                if i1 > 0 and x < nodes[i1 - 1]:
+                    i1 -= 1
+                elif i1 < len(nodes) and x >= nodes[i1]:
+                    i1 += 1
+                else:
+                    self.hits += 1
+                    self._last = i1
+                    return i1
+        self.misses += 1
+        i1 = bisect.bisect_right(nodes, x)
+        self._last = i1
+        return i1
+
+    def locate_many(self, xs: np.ndarray) -> np.ndarray:
+        """Vectorized locate(); a plain searchsorted, counted under "searched" rather than hits/misses."""
+        self.searched += len(xs)
+        return np.searchsorted(self._nodes, xs, side="right")
+
+    def stats(self) -> Dict[str, int]:
+        return {"hits": self.hits, "misses": self.misses, "searched": self.searched}
+
+
+class UniformGridAxis(GridAxis):
+    """Evenly spaced axis: the bracket is computed from the spacing instead of searched.
+
+    The arithmetic guess is corrected by at most one node so results match
+    searchsorted(side="right") exactly, even when x sits on a node. No bracket is
+    reused, so hits/misses stay zero and "arithmetic" counts the lookups instead.
+    """
+
+    def __init__(self, nodes: List[float], reuse_cells: int):
+        super().__init__(nodes, reuse_cells)
+        self.arithmetic = 0
+        self._x0 = self.nodes[0]
+        self._inv_step = (len(self.nodes) - 1) / (self.nodes[-1] - self.nodes[0])
+
+    def locate(self, x: float) -> int:
+        nodes = self.nodes
+        n = len(nodes)
+        i1 = min(max(int(np.floor((x - self._x0) * self._inv_step)) + 1, 0), n)
+        if i1 > 0 and x < nodes[i1 - 1]:
+            i1 -= 1
+        elif i1 < n and x >= nodes[i1]:
+            i1 += 1
+        self.arithmetic += 1
+        return i1
+
+    def locate_many(self, xs: np.ndarray) -> np.ndarray:
+        nodes = self._nodes
+        n = len(nodes)
+        xs = np.asarray(xs, dtype=float)
+        i1 = np.clip(np.floor((xs - self._x0) * self._inv_step).astype(np.int64) + 1, 0, n)
+        down = (i1 > 0) & (xs < nodes[np.maximum(i1 - 1, 0)])
+        up = ~down & (i1 < n) & (xs >= nodes[np.minimum(i1, n - 1)])
+        self.arithmetic += len(xs)
+        return i1 - down + up
+
+    def stats(self) -> Dict[str, int]:
+        return {**super().stats(), "arithmetic": self.arithmetic}
+
+
+def make_grid_axis(nodes: List[float], reuse_cells: int) -> GridAxis:
+    """UniformGridAxis when the nodes are evenly spaced, otherwise the searching GridAxis.
+
+    reuse_cells only matters for the scalar locate() of a non-uniform axis: the uniform axis
+    computes the cell directly and the batch path is a plain searchsorted.
+    """
+    arr = np.asarray(nodes, dtype=float)
+    if len(arr) >= 3 and arr[-1] > arr[0]:
+        step = np.diff(arr)
+        if np.allclose(step, step[0], rtol=1e-9, atol=0.0):
+            return UniformGridAxis(nodes, reuse_cells)
+    return GridAxis(nodes, reuse_cells)
+
+
+class BilinearWeights:
+    """Sparse CSR matrix [point x grid node] holding the bilinear weights of each point.
+
+    Every row has four entries (degenerate corners get weight 0), so flux for a batch is one
+    gather-multiply-reduce against the flattened grid instead of a per-point interpolation.
+    """
+
+    def __init__(self, indptr: np.ndarray, indices: np.ndarray, data: np.ndarray, n_nodes: int):
+        self.indptr = indptr
+        self.indices = indices
+        self.data = data
+        self.n_nodes = n_nodes
+
+    def __len__(self) -> int:
+        return len(self.indptr) - 1
+
+    def dot(self, values: np.ndarray) -> np.ndarray:
+        if len(self) == 0:
+            return np.empty(0)
+        return np.add.reduceat(self.data * values[self.indices], self.indptr[:-1])
+
+
+_spenvis_grids: Dict[Tuple[str, str], Tuple[np.ndarray, np.ndarray, np.ndarray]] = {}
+_spenvis_grids_lock = threading.Lock()
 
 
 class AP8AE8Model(FluxModel):
     def __init__(self, cfg: AP8AE8Config):
         self.cfg = cfg
         self.channel = cfg.channel
+        self.channels = [cfg.channel]
         self.alt_km = cfg.alt_km
-        self.latitudes, self.longitudes, self.grid = self._load_grid(cfg.pos_path, cfg.flux_path)
+        self.latitudes, self.longitudes, self.grid = self._shared_grid(cfg)
+        self.lat_axis = make_grid_axis(self.latitudes, cfg.bracket_reuse_cells)
+        self.lon_axis = make_grid_axis(self.longitudes, cfg.bracket_reuse_cells)
 
     def flux(self, point: TrackPoint, percentile: str) -> Dict[str, float]:
-        return self.flux_batch([point], percentile)[0]
+        return {self.channel: float(self._interp_flux(point.lat, point.lon))}
 
-    def flux_batch(self, points: List[TrackPoint], percentile: str) -> List[Dict[str, float]]:
-        values: List[Dict[str, float]] = []
-        for pt in points:
-            val = self._interp_flux(pt.lat, pt.lon)
-            values.append({self.channel: val})
-        return values
+    def flux_into(self, cols: TrackColumns, percentile: str, out: np.ndarray) -> None:
+        weights = self._bilinear_weights(np.asarray(cols.lat, dtype=float), np.asarray(cols.lon, dtype=float))
+        out[:, 0] = weights.dot(np.asarray(self.grid).reshape(-1))
+
+    def _bilinear_weights(self, lat: np.ndarray, lon: np.ndarray) -> BilinearWeights:
+        latitudes = np.asarray(self.latitudes, dtype=float)
+        longitudes = np.asarray(self.longitudes, dtype=float)
+        lon = np.where(lon > 180.0, lon - 360.0 * np.ceil((lon - 180.0) / 360.0), lon)
+        lon = np.where(lon < -180.0, lon + 360.0 * np.ceil((-180.0 - lon) / 360.0), lon)
+        lat = np.clip(lat, latitudes[0], latitudes[-1])
+        lon = np.clip(lon, longitudes[0], longitudes[-1])
+        i0, i1, ty = self._brackets(self.lat_axis, latitudes, lat)
+        j0, j1, tx = self._brackets(self.lon_axis, longitudes, lon)
+        n_lon = len(longitudes)
+        indices = np.stack([i0 * n_lon + j0, i0 * n_lon + j1, i1 * n_lon + j0, i1 * n_lon + j1], axis=1)
+        data = np.stack([(1.0 - tx) * (1.0 - ty), tx * (1.0 - ty), (1.0 - tx) * ty, tx * ty], axis=1)
+        indptr = np.arange(0, 4 * len(lat) + 1, 4)
+        return BilinearWeights(indptr, indices.reshape(-1), data.reshape(-1), len(latitudes) * n_lon)
 
-    def grid_values(self, channel: str) -> Tuple[List[float], List[float], List[List[float]]]:
+    @staticmethod
+    def _brackets(axis: GridAxis, nodes: np.ndarray, x: np.ndarray) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+        """Lower/upper node index and fractional position of x, clamped at the grid edges."""
+        hi = np.clip(axis.locate_many(x), 0, len(nodes) - 1)
+        lo = np.clip(hi - 1, 0, None)
+        lo = np.where(x >= nodes[-1], hi, lo)
+        span = nodes[hi] - nodes[lo]
+        frac = np.divide(x - nodes[lo], span, out=np.zeros(len(x)), where=span != 0)
+        return lo, hi, frac
+
+    def lookup_stats(self) -> Dict[str, Dict[str, int]]:
+        return {"lat": self.lat_axis.stats(), "lon": self.lon_axis.stats()}
+
+    def grid_values(self, channel: str) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+        """Read-only views of the grid; callers must not mutate them."""
         if channel != self.channel:
-            empty = [[0.0 for _ in self.longitudes] for _ in self.latitudes]
-            return list(self.latitudes), list(self.longitudes), empty
-        return list(self.latitudes), list(self.longitudes), [row[:] for row in self.grid]
+            return self.latitudes, self.longitudes, np.zeros(self.grid.shape)
+        return self.latitudes, self.longitudes, self.grid
 
     def _interp_flux(self, lat: float, lon: float) -> float:
         lon = self._normalize_lon(lon)
-        latitudes = np.asarray(self.latitudes, dtype=float)
-        longitudes = np.asarray(self.longitudes, dtype=float)
-        lat = float(np.clip(lat, latitudes[0], latitudes[-1]))
-        lon = float(np.clip(lon, longitudes[0], longitudes[-1]))
+        latitudes = self.lat_axis.nodes
+        longitudes = self.lon_axis.nodes
+        lat = min(max(lat, latitudes[0]), latitudes[-1])
+        lon = min(max(lon, longitudes[0]), longitudes[-1])
 
-        i1 = int(np.searchsorted(latitudes, lat, side="right"))
+        i1 = self.lat_axis.locate(lat)
         if i1 <= 0:
             i0 = i1 = 0
         elif i1 >= len(latitudes):
@@ -166,7 +745,7 @@ class AP8AE8Model(FluxModel):
         else:
             i0 = i1 - 1
 
-        j1 = int(np.searchsorted(longitudes, lon, side="right"))
+        j1 = self.lon_axis.locate(lon)
         if j1 <= 0:
             j0 = j1 = 0
         elif j1 >= len(longitudes):
@@ -175,16 +754,16 @@ class AP8AE8Model(FluxModel):
             j0 = j1 - 1
 
         if i0 == i1 and j0 == j1:
-            return self.grid[i0][j0]
+            return self.grid[i0, j0]
         if i0 == i1:
-            return self._lerp(self.grid[i0][j0], self.grid[i0][j1], longitudes[j0], longitudes[j1], lon)
+            return self._lerp(self.grid[i0, j0], self.grid[i0, j1], longitudes[j0], longitudes[j1], lon)
         if j0 == j1:
-            return self._lerp(self.grid[i0][j0], self.grid[i1][j0], latitudes[i0], latitudes[i1], lat)
+            return self._lerp(self.grid[i0, j0], self.grid[i1, j0], latitudes[i0], latitudes[i1], lat)
 
-        f00 = self.grid[i0][j0]
-        f01 = self.grid[i0][j1]
-        f10 = self.grid[i1][j0]
-        f11 = self.grid[i1][j1]
+        f00 = self.grid[i0, j0]
+        f01 = self.grid[i0, j1]
+        f10 = self.grid[i1, j0]
+        f11 = self.grid[i1, j1]
         lon0 = longitudes[j0]
         lon1 = longitudes[j1]
         lat0 = latitudes[i0]
@@ -210,6 +789,57 @@ class AP8AE8Model(FluxModel):
             lon += 360.0
         return lon
 
+    def _shared_grid(self, cfg: AP8AE8Config) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+        """One read-only grid per source files per process, shared by every model instance and rebuild."""
+        sources = self._source_signature(cfg)
+        key = (json.dumps(sources), cfg.compiled_cache_dir)
+        with _spenvis_grids_lock:
+            if key not in _spenvis_grids:
+                paths = [src[0] for src in sources]
+                for stale in [k for k in _spenvis_grids if [src[0] for src in json.loads(k[0])] == paths]:
+                    del _spenvis_grids[stale]
+                arrays = self._load_compiled_grid(cfg, sources)
+                for arr in arrays:
+                    arr.setflags(write=False)
+                _spenvis_grids[key] = arrays
+            return _spenvis_grids[key]
+
+    @staticmethod
+    def _source_signature(cfg: AP8AE8Config) -> List[List]:
+        sources = []
+        for src in (Path(cfg.pos_path), Path(cfg.flux_path)):
+            st = src.stat()
+            sources.append([str(src.resolve()), st.st_size, st.st_mtime_ns])
+        return sources
+
+    def _load_compiled_grid(self, cfg: AP8AE8Config, sources: List[List]) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+        """Parse the SPENVIS text files once into .npy files and memory-map them read-only afterwards.
+
+        Worker processes on the same host map the same files, so they share one copy in the page cache.
+        Files are named spenvis_<source paths>_<size and mtime>.*.npy; compiling a new version of the
+        same sources removes the files of the older versions.
+        """
+        if not cfg.compiled_cache_dir:
+            latitudes, longitudes, grid = self._load_grid(cfg.pos_path, cfg.flux_path)
+            return np.asarray(latitudes, dtype=float), np.asarray(longitudes, dtype=float), np.asarray(grid, dtype=float)
+        source_key = hashlib.sha256(json.dumps([src[0] for src in sources]).encode("utf-8")).hexdigest()[:16]
+        version_key = hashlib.sha256(json.dumps(sources).encode("utf-8")).hexdigest()[:16]
+        cache_dir = Path(cfg.compiled_cache_dir)
+        paths = [cache_dir / f"spenvis_{source_key}_{version_key}.{name}.npy" for name in ("lat", "lon", "grid")]
+        if not all(path.exists() for path in paths):
+            arrays = self._load_grid(cfg.pos_path, cfg.flux_path)
+            for path, arr in zip(paths, arrays):
+                buf = io.BytesIO()
+                np.save(buf, np.asarray(arr, dtype=float))
+                _atomic_write_bytes(path, buf.getvalue())
+            for stale in cache_dir.glob(f"spenvis_{source_key}_*.npy"):
+                if stale not in paths:
+                    try:
+                        stale.unlink()
+                    except OSError as exc:  # still mapped by another process on some platforms
+                        logger.warning("Could not remove stale compiled grid %s: %s", stale, exc)
+        return tuple(np.load(path, mmap_mode="r") for path in paths)
+
     def _load_grid(self, pos_path: str, flux_path: str) -> Tuple[List[float], List[float], List[List[float]]]:
         pos_lines = Path(pos_path).read_text(encoding="utf-8", errors="ignore").splitlines()
         flux_lines = Path(flux_path).read_text(encoding="utf-8", errors="ignore").splitlines()
@@ -285,6 +915,112 @@ class AP8AE8Model(FluxModel):
         return rows
 
 
+class FluxGridTable:
+    """Flux tabulated on an (alt, lat, lon) node grid at one time bucket, with trilinear lookup."""
+
+    def __init__(
+        self,
+        altitudes: np.ndarray,
+        latitudes: np.ndarray,
+        longitudes: np.ndarray,
+        values: np.ndarray,
+        max_rel_err: float = np.inf,
+    ):
+        self.altitudes = np.asarray(altitudes, dtype=float)
+        self.latitudes = np.asarray(latitudes, dtype=float)
+        self.longitudes = np.asarray(longitudes, dtype=float)
+        self.values = np.asarray(values, dtype=float)  # [alt, lat, lon, channel]
+        self.max_rel_err = max_rel_err
+
+    @classmethod
+    def build(cls, model: FluxModel, t: datetime, percentile: str, cfg: AE9AP9CLIConfig) -> "FluxGridTable":
+        altitudes = np.unique(np.asarray(cfg.grid_alt_layers_km, dtype=float))
+        latitudes = np.arange(-90.0, 90.0 + cfg.grid_lat_step_deg, cfg.grid_lat_step_deg)
+        longitudes = np.arange(-180.0, 180.0 + cfg.grid_lon_step_deg, cfg.grid_lon_step_deg)
+        alt_mesh, lat_mesh, lon_mesh = np.meshgrid(altitudes, latitudes, longitudes, indexing="ij")
+        cols = TrackColumns(
+            t=np.full(alt_mesh.size, t.timestamp()),
+            lat=lat_mesh.ravel(),
+            lon=lon_mesh.ravel(),
+            alt_km=alt_mesh.ravel(),
+        )
+        values = model.flux_array(cols, percentile)
+        table = cls(altitudes, latitudes, longitudes, values.reshape(alt_mesh.shape + (len(model.channels),)))
+        table.max_rel_err = table._check_error(model, t, percentile, cfg.grid_lookup_check_points)
+        return table
+
+    @classmethod
+    def load(cls, path: Path) -> "FluxGridTable":
+        with np.load(path) as data:
+            return cls(data["altitudes"], data["latitudes"], data["longitudes"], data["values"], float(data["max_rel_err"]))
+
+    def save(self, path: Path) -> None:
+        buf = io.BytesIO()
+        np.savez(
+            buf,
+            altitudes=self.altitudes,
+            latitudes=self.latitudes,
+            longitudes=self.longitudes,
+            values=self.values,
+            max_rel_err=self.max_rel_err,
+        )
+        _atomic_write_bytes(path, buf.getvalue())
+
+    def covers(self, cols: TrackColumns) -> np.ndarray:
+        return (cols.alt_km >= self.altitudes[0]) & (cols.alt_km <= self.altitudes[-1])
+
+    def interpolate(self, cols: TrackColumns) -> np.ndarray:
+        a0, a1, wa = self._bracket(self.altitudes, cols.alt_km)
+        i0, i1, wi = self._bracket(self.latitudes, cols.lat)
+        j0, j1, wj = self._bracket(self.longitudes, ((cols.lon + 180.0) % 360.0) - 180.0)
+        v = self.values
+        wa, wi, wj = wa[:, None], wi[:, None], wj[:, None]
+        c0 = (v[a0, i0, j0] * (1 - wj) + v[a0, i0, j1] * wj) * (1 - wi) + (v[a0, i1, j0] * (1 - wj) + v[a0, i1, j1] * wj) * wi
+        c1 = (v[a1, i0, j0] * (1 - wj) + v[a1, i0, j1] * wj) * (1 - wi) + (v[a1, i1, j0] * (1 - wj) + v[a1, i1, j1] * wj) * wi
+        return c0 * (1 - wa) + c1 * wa
+
+    def _check_error(self, model: FluxModel, t: datetime, percentile: str, n_points: int) -> float:
+        # Cell midpoints are where trilinear interpolation is least accurate.
+        if n_points <= 0:
+            return np.inf
+        rng = np.random.default_rng(0)
+        alt_mid = self._midpoints(self.altitudes)
+        cols = TrackColumns(
+            t=np.full(n_points, t.timestamp()),
+            lat=rng.choice(self._midpoints(self.latitudes), n_points),
+            lon=rng.choice(self._midpoints(self.longitudes), n_points),
+            alt_km=rng.choice(alt_mid, n_points),
+        )
+        exact = model.flux_array(cols, percentile)
+        approx = self.interpolate(cols)
+        valid = ~np.isnan(exact) & ~np.isnan(approx)
+        if not valid.any():
+            return np.inf
+        rel = np.abs(approx[valid] - exact[valid]) / np.maximum(np.abs(exact[valid]), 1e-30)
+        return float(rel.max())
+
+    @staticmethod
+    def _midpoints(nodes: np.ndarray) -> np.ndarray:
+        if len(nodes) < 2:
+            return nodes
+        return 0.5 * (nodes[:-1] + nodes[1:])
+
+    @staticmethod
+    def _bracket(nodes: np.ndarray, x: np.ndarray) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+        if len(nodes) < 2:
+            zeros = np.zeros(len(x), dtype=int)
+            return zeros, zeros, np.zeros(len(x))
+        x = np.clip(x, nodes[0], nodes[-1])
+        i1 = np.clip(np.searchsorted(nodes, x, side="right"), 1, len(nodes) - 1)
+        i0 = i1 - 1
+        w = (x - nodes[i0]) / (nodes[i1] - nodes[i0])
+        return i0, i1, np.clip(w, 0.0, 1.0)
+
+
+_grid_tables: "OrderedDict[str, FluxGridTable]" = OrderedDict()
+_grid_tables_lock = threading.Lock()
+
+
 class FluxService:
     def __init__(self, cfg: FluxConfig):
         self.cfg = cfg
@@ -307,14 +1043,124 @@ class FluxService:
             return MockFluxModel(cfg.mock_profile)
         return AE9AP9Model(cfg.ae9ap9, channels)
 
+    def stats(self) -> Dict:
+        if isinstance(self.model, AP8AE8Model):
+            return {"grid_lookup": self.model.lookup_stats()}
+        if isinstance(self.model, AE9AP9Model):
+            return {"segments": self.model.schedule_stats()}
+        return {}
+
+    def pipeline_chunk_points(self, chunk_points: int) -> int:
+        """Chunk size for the streaming pipeline, widened so AE9/AP9 workers all get a CLI call per chunk.
+
+        Larger chunks give up some stage overlap and memory for keeping ae9ap9.workers busy.
+        """
+        if not isinstance(self.model, AE9AP9Model) or self.cfg.ae9ap9.workers <= 1:
+            return chunk_points
+        cfg = self.cfg.ae9ap9
+        unit = cfg.schedule_segment_points if cfg.schedule_segment_points > 0 else cfg.max_points_per_call
+        return max(chunk_points, cfg.workers * (unit if unit > 0 else 2000))
+
     def compute_series(self, track: List[TrackPoint], percentile: str) -> List[FluxSample]:
         series: List[FluxSample] = []
-        values_list = self.model.flux_batch(track, percentile)
-        for pt, values in zip(track, values_list):
-            for ch, val in values.items():
-                series.append(FluxSample(t=pt.t, channel=ch, value=val, percentile=percentile))
+        values = self.flux_values(TrackColumns.from_points(track), percentile)
+        for pt, row in zip(track, values):
+            for ch, val in zip(self.model.channels, row):
+                if np.isnan(val):
+                    continue
+                series.append(FluxSample(t=pt.t, channel=ch, value=float(val), percentile=percentile))
+        return series
+
+    def compute_series_many(self, track: List[TrackPoint], percentiles: List[str]) -> List[FluxSample]:
+        if len(percentiles) == 1:
+            return self.compute_series(track, percentiles[0])
+        values = self.flux_values_many(TrackColumns.from_points(track), percentiles)
+        series: List[FluxSample] = []
+        for percentile, block in zip(percentiles, values):
+            for pt, row in zip(track, block):
+                for ch, val in zip(self.model.channels, row):
+                    if np.isnan(val):
+                        continue
+                    series.append(FluxSample(t=pt.t, channel=ch, value=float(val), percentile=percentile))
         return series
 
+    def flux_values_many(self, cols: TrackColumns, percentiles: List[str]) -> np.ndarray:
+        """Flux [percentile x point x channel]; percentiles run concurrently over the same columns."""
+        out = np.empty((len(percentiles), len(cols), len(self.model.channels)), dtype=float)
+
+        def fill(k: int) -> None:
+            out[k] = self.flux_values(cols, percentiles[k])
+
+        workers = min(self.cfg.percentile_workers, len(percentiles))
+        if workers <= 1:
+            for k in range(len(percentiles)):
+                fill(k)
+            return out
+        with ThreadPoolExecutor(max_workers=workers) as pool:
+            for future in [pool.submit(fill, k) for k in range(len(percentiles))]:
+                future.result()
+        return out
+
+    def flux_values(self, cols: TrackColumns, percentile: str) -> np.ndarray:
+        """Flux [point x channel]; points inside a validated grid table are interpolated, the rest run the model."""
+        cfg = self.cfg.ae9ap9
+        if not self._grid_table_enabled() or cfg.grid_lookup_rel_err <= 0:
+            return self.model.flux_array(cols, percentile)
+        out = np.empty((len(cols), len(self.model.channels)), dtype=float)
+        exact = np.ones(len(cols), dtype=bool)
+        buckets = np.floor(cols.t / cfg.time_bucket_sec) * cfg.time_bucket_sec
+        # Only points between the configured altitude layers can use a table; skip building one otherwise.
+        inside = (cols.alt_km >= min(cfg.grid_alt_layers_km)) & (cols.alt_km <= max(cfg.grid_alt_layers_km))
+        for bucket in np.unique(buckets[inside]):
+            idx = np.flatnonzero((buckets == bucket) & inside)
+            table = self._grid_table(datetime.fromtimestamp(float(bucket), tz=timezone.utc), percentile)
+            if table.max_rel_err > cfg.grid_lookup_rel_err:
+                continue
+            idx = idx[table.covers(cols.take(idx))]
+            out[idx] = table.interpolate(cols.take(idx))
+            exact[idx] = False
+        if exact.any():
+            idx = np.flatnonzero(exact)
+            out[idx] = self.model.flux_array(cols.take(idx), percentile)
+        return out
+
+    def _grid_table_enabled(self) -> bool:
+        cfg = self.cfg.ae9ap9
+        return cfg.grid_table_enabled and cfg.time_bucket_sec > 0 and isinstance(self.model, AE9AP9Model)
+
+    def _grid_table(self, t_bucketed: datetime, percentile: str) -> FluxGridTable:
+        cfg = self.cfg.ae9ap9
+        raw = json.dumps(
+            {
+                "t": t_bucketed.isoformat(),
+                "percentile": percentile,
+                "channels": self.model.channels,
+                "lat_step": cfg.grid_lat_step_deg,
+                "lon_step": cfg.grid_lon_step_deg,
+                "altitudes": sorted(cfg.grid_alt_layers_km),
+                "check_points": cfg.grid_lookup_check_points,
+                "cli": cli_signature(cfg),
+            },
+            sort_keys=True,
+        ).encode("utf-8")
+        key = hashlib.sha256(raw).hexdigest()
+        with _grid_tables_lock:
+            table = _grid_tables.get(key)
+            if table is not None:
+                _grid_tables.move_to_end(key)
+                return table
+        path = Path(cfg.cache_dir) / f"grid_{key}.npz"
+        if path.exists() and datetime.now(timezone.utc).timestamp() - path.stat().st_mtime <= cfg.cache_ttl_sec:
+            table = FluxGridTable.load(path)
+        else:
+            table = FluxGridTable.build(self.model, t_bucketed, percentile, cfg)
+            table.save(path)
+        with _grid_tables_lock:
+            _grid_tables[key] = table
+            while len(_grid_tables) > max(cfg.grid_table_max_entries, 1):
+                _grid_tables.popitem(last=False)
+        return table
+
     def compute_grid(
         self,
         t: datetime,
@@ -324,47 +1170,38 @@ class FluxService:
     ) -> Tuple[List[float], List[float], List[List[List[float]]]]:
         if isinstance(self.model, AP8AE8Model):
             lats, lons, grid = self.model.grid_values(channel)
-            return lats, lons, [grid]
+            return lats.tolist(), lons.tolist(), [grid.tolist()]
         cfg = self.cfg.ae9ap9
         t_bucketed = self._time_bucket(t, cfg.time_bucket_sec)
+        if self._grid_table_enabled() and set(altitudes_km) <= set(cfg.grid_alt_layers_km) and channel in self.model.channels:
+            table = self._grid_table(t_bucketed, percentile)
+            j = self.model.channels.index(channel)
+            layers = [int(np.flatnonzero(table.altitudes == alt)[0]) for alt in altitudes_km]
+            values = table.values[layers, :, :, j]
+            return table.latitudes.tolist(), table.longitudes.tolist(), np.where(np.isnan(values), 0.0, values).tolist()
         latitudes = list(np.arange(-90.0, 90.0 + cfg.grid_lat_step_deg, cfg.grid_lat_step_deg))
         longitudes = list(np.arange(-180.0, 180.0 + cfg.grid_lon_step_deg, cfg.grid_lon_step_deg))
+        lat_mesh, lon_mesh = np.meshgrid(np.asarray(latitudes, dtype=float), np.asarray(longitudes, dtype=float), indexing="ij")
         values_3d: List[List[List[float]]] = []
 
         for alt in altitudes_km:
-            points: List[TrackPoint] = []
-            for lat in latitudes:
-                for lon in longitudes:
-                    points.append(
-                        TrackPoint(
-                            t=t_bucketed,
-                            lat=float(lat),
-                            lon=float(lon),
-                            alt_km=float(alt),
-                            tle_epoch=t,
-                            orbit_quality=1.0,
-                        )
-                    )
-            values = self._compute_grid_for_points(points, channel, percentile)
-            grid = []
-            idx = 0
-            for _ in latitudes:
-                row = values[idx : idx + len(longitudes)]
-                grid.append(row)
-                idx += len(longitudes)
-            values_3d.append(grid)
+            cols = TrackColumns(
+                t=np.full(lat_mesh.size, t_bucketed.timestamp()),
+                lat=lat_mesh.ravel(),
+                lon=lon_mesh.ravel(),
+                alt_km=np.full(lat_mesh.size, float(alt)),
+            )
+            values = self._compute_grid_for_points(cols, channel, percentile)
+            values_3d.append(values.reshape(len(latitudes), len(longitudes)).tolist())
 
         return latitudes, longitudes, values_3d
 
-    def _compute_grid_for_points(self, points: List[TrackPoint], channel: str, percentile: str) -> List[float]:
-        cfg = self.cfg.ae9ap9
-        all_values: List[float] = []
-        max_points = cfg.max_points_per_call if cfg.max_points_per_call > 0 else 2000
-        for i in range(0, len(points), max_points):
-            chunk = points[i : i + max_points]
-            data = self.model.flux_batch(chunk, percentile)
-            all_values.extend([vals.get(channel, 0.0) for vals in data])
-        return all_values
+    def _compute_grid_for_points(self, cols: TrackColumns, channel: str, percentile: str) -> np.ndarray:
+        if channel not in self.model.channels:
+            return np.zeros(len(cols))
+        j = self.model.channels.index(channel)
+        out = self.model.flux_array(cols, percentile)
+        return np.where(np.isnan(out[:, j]), 0.0, out[:, j])
 
     @staticmethod
     def _time_bucket(t: datetime, bucket_sec: int) -> datetime:
@@ -1,11 +1,11 @@
 from __future__ import annotations
 
 from datetime import datetime, timedelta, timezone
-from typing import List, Optional
+from typing import Iterator, List, Optional
 
 import numpy as np
 import pymap3d as pm
-from sgp4.api import Satrec, WGS72
+from sgp4.api import Satrec, SatrecArray, WGS72
 
 from app.config import OrbitConfig
 from app.models import OrbitState, TrackPoint, TLESet
@@ -34,22 +34,70 @@ class OrbitService:
         )
 
     def track(self, tle: TLESet, start: datetime, end: datetime, step_sec: int) -> List[TrackPoint]:
-        points: List[TrackPoint] = []
-        t = start
-        while t <= end:
-            state = self.propagate(tle, t)
-            points.append(
+        if not self.cfg.batch_transform:
+            return [self._track_point(self.propagate(tle, t)) for t in self._time_grid(start, end, step_sec)]
+        return self.track_many([tle], start, end, step_sec)[0]
+
+    def track_many(self, tles: List[TLESet], start: datetime, end: datetime, step_sec: int) -> List[List[TrackPoint]]:
+        """Propagate N TLEs over one shared time grid with a single vectorized SGP4 call."""
+        times = self._time_grid(start, end, step_sec)
+        if not times or not tles:
+            return [[] for _ in tles]
+        jd = np.empty(len(times))
+        fr = np.empty(len(times))
+        for i, t in enumerate(times):
+            jd[i], fr[i] = self._datetime_to_jdfr(t)
+        sats = SatrecArray([Satrec.twoline2rv(tle.line1, tle.line2, WGS72) for tle in tles])
+        errors, r_teme, _ = sats.sgp4(jd, fr)
+        if np.any(errors != 0):
+            # One failing satellite fails the whole batch; report which one.
+            n, i = np.argwhere(errors != 0)[0]
+            raise RuntimeError(f"SGP4 error code {int(errors[n, i])} for NORAD {tles[n].norad_id} at {times[i].isoformat()}")
+        lat, lon, alt = self._teme_to_geodetic_batch(r_teme.reshape(-1, 3), np.tile(jd + fr, len(tles)))
+        shape = (len(tles), len(times))
+        lat, lon, alt = lat.reshape(shape), lon.reshape(shape), alt.reshape(shape)
+        return [
+            [
                 TrackPoint(
-                    t=state.t,
-                    lat=state.lat,
-                    lon=state.lon,
-                    alt_km=state.alt_km,
-                    tle_epoch=state.tle_epoch,
-                    orbit_quality=state.orbit_quality,
+                    t=t,
+                    lat=float(lat[n, i]),
+                    lon=float(lon[n, i]),
+                    alt_km=float(alt[n, i]),
+                    tle_epoch=tle.epoch,
+                    orbit_quality=tle.score,
                 )
-            )
+                for i, t in enumerate(times)
+            ]
+            for n, tle in enumerate(tles)
+        ]
+
+    @staticmethod
+    def _time_grid(start: datetime, end: datetime, step_sec: int) -> List[datetime]:
+        times: List[datetime] = []
+        t = start
+        while t <= end:
+            times.append(t)
             t += timedelta(seconds=step_sec)
-        return points
+        return times
+
+    def iter_track(self, tle: TLESet, start: datetime, end: datetime, step_sec: int, chunk_points: int) -> Iterator[List[TrackPoint]]:
+        """Yield the same points as track() in chunks of at most chunk_points."""
+        chunk_points = max(chunk_points, 1)
+        t = start
+        while t <= end:
+            yield self.track(tle, t, min(t + timedelta(seconds=step_sec * (chunk_points - 1)), end), step_sec)
+            t += timedelta(seconds=step_sec * chunk_points)
+
+    @staticmethod
+    def _track_point(state: OrbitState) -> TrackPoint:
+        return TrackPoint(
+            t=state.t,
+            lat=state.lat,
+            lon=state.lon,
+            alt_km=state.alt_km,
+            tle_epoch=state.tle_epoch,
+            orbit_quality=state.orbit_quality,
+        )
 
     def _teme_to_geodetic(self, r_teme: list[float], t: datetime) -> tuple[float, float, float]:
         if self.cfg.teme_to_ecef != "pymap3d":
@@ -62,17 +110,29 @@ class OrbitService:
             x_ecef, y_ecef, z_ecef = pm.eci2ecef(r_m[0], r_m[1], r_m[2], t)
         else:
             jd, fr = self._datetime_to_jdfr(t)
-            gmst = self._gmst(jd + fr)
-            x_teme, y_teme, z_teme = r_m
-            x_ecef = x_teme * np.cos(gmst) - y_teme * np.sin(gmst)
-            y_ecef = x_teme * np.sin(gmst) + y_teme * np.cos(gmst)
-            z_ecef = z_teme
+            x_ecef, y_ecef, z_ecef = self._rotate_teme_to_ecef(r_m[0], r_m[1], r_m[2], self._gmst(jd + fr))
         lat, lon, alt = pm.ecef2geodetic(x_ecef, y_ecef, z_ecef, deg=True)
         lon = ((lon + 180.0) % 360.0) - 180.0  # normalize to [-180, 180]
         return float(lat), float(lon), float(alt / 1000.0)
 
+    def _teme_to_geodetic_batch(self, r_teme: np.ndarray, jd: np.ndarray) -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+        """Vectorized TEME->geodetic for N positions (km) at N Julian dates, using the GMST rotation."""
+        if self.cfg.teme_to_ecef != "pymap3d":
+            raise ValueError("Unsupported teme_to_ecef method")
+        r_m = np.asarray(r_teme, dtype=float) * 1000.0
+        x_ecef, y_ecef, z_ecef = self._rotate_teme_to_ecef(r_m[:, 0], r_m[:, 1], r_m[:, 2], self._gmst(np.asarray(jd)))
+        lat, lon, alt = pm.ecef2geodetic(x_ecef, y_ecef, z_ecef, deg=True)
+        lon = ((np.asarray(lon) + 180.0) % 360.0) - 180.0
+        return np.asarray(lat, dtype=float), lon, np.asarray(alt, dtype=float) / 1000.0
+
+    @staticmethod
+    def _rotate_teme_to_ecef(x, y, z, gmst):
+        cos_g = np.cos(gmst)
+        sin_g = np.sin(gmst)
+        return x * cos_g + y * sin_g, -x * sin_g + y * cos_g, z
+
     @staticmethod
-    def _gmst(jd: float) -> float:
+    def _gmst(jd):
         """Greenwich mean sidereal time (radians) for TEME->ECEF fallback."""
         T = (jd - 2451545.0) / 36525.0
         gmst_deg = 280.46061837 + 360.98564736629 * (jd - 2451545.0) + 0.000387933 * T**2 - T**3 / 38710000.0
@@ -0,0 +1,63 @@
+from __future__ import annotations
+
+import queue
+import threading
+from typing import Callable, Iterable, Iterator, Optional
+
+_DONE = object()
+
+
+class _Failure:
+    def __init__(self, exc: BaseException):
+        self.exc = exc
+
+
+def prefetch(source: Iterable, maxsize: int = 2, stage: Optional[Callable] = None) -> Iterator:
+    """Drain source (optionally mapped through stage) on a background thread into a bounded queue."""
+    buf: queue.Queue = queue.Queue(maxsize=max(maxsize, 1))
+    stop = threading.Event()
+
+    def put(item) -> bool:
+        while not stop.is_set():
+            try:
+                buf.put(item, timeout=0.1)
+                return True
+            except queue.Full:
+                continue
+        return False
+
+    def produce() -> None:
+        try:
+            for item in source:
+                if not put(stage(item) if stage else item):
+                    return
+        except BaseException as exc:  # re-raised on the consumer side
+            put(_Failure(exc))
+            return
+        finally:
+            # Stops upstream stages when this one is abandoned early.
+            close = getattr(source, "close", None)
+            if close:
+                close()
+        put(_DONE)
+
+    worker = threading.Thread(target=produce, daemon=True)
+    worker.start()
+    try:
+        while True:
+            item = buf.get()
+            if item is _DONE:
+                return
+            if isinstance(item, _Failure):
+                raise item.exc
+            yield item
+    finally:
+        stop.set()
+
+
+def staged(source: Iterable, *stages: Callable, maxsize: int = 2) -> Iterator:
+    """Chain stages over source with a bounded queue between each, so all stages run concurrently."""
+    items = prefetch(source, maxsize)
+    for stage in stages:
+        items = prefetch(items, maxsize, stage)
+    return items
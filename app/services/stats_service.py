@@ -0,0 +1,250 @@
+from __future__ import annotations
+
+from typing import Iterable, List, Optional, Tuple, Union
+
+import numpy as np
+
+from app.config import StatsConfig
+
+
+class ExactAggregator:
+    """Keeps every sample of every cell; quantiles are exact nearest-rank values."""
+
+    def __init__(self, n_cells: int):
+        self.n_cells = n_cells
+        self.count = np.zeros(n_cells, dtype=np.int64)
+        self.total = np.zeros(n_cells)
+        self._chunks: List[np.ndarray] = []
+        self._times: List[np.ndarray] = []
+
+    def add(self, values: np.ndarray, t: Optional[np.ndarray] = None) -> None:
+        """Add a [sample x cell] block; NaN entries are ignored. t optionally tags each sample row."""
+        values = np.asarray(values, dtype=float).reshape(-1, self.n_cells)
+        valid = ~np.isnan(values)
+        self.count += valid.sum(axis=0)
+        self.total += np.where(valid, values, 0.0).sum(axis=0)
+        self._chunks.append(values)
+        self._times.append(np.full(len(values), np.nan) if t is None else np.asarray(t, dtype=float))
+
+    def merge(self, other: "ExactAggregator") -> "ExactAggregator":
+        self.count += other.count
+        self.total += other.total
+        self._chunks.extend(other._chunks)
+        self._times.extend(other._times)
+        return self
+
+    def mean(self) -> np.ndarray:
+        return np.divide(self.total, self.count, out=np.full(self.n_cells, np.nan), where=self.count > 0)
+
+    def conf_levels(self, percents: List[float]) -> Tuple[np.ndarray, np.ndarray]:
+        """Nearest-rank values and the sample row holding them, one row per requested percent.
+
+        All requested ranks of all cells are selected in one argpartition pass (NaN sorted
+        last as +inf) instead of fully sorting every cell. Rows are -1 for empty cells.
+        """
+        values = np.full((len(percents), self.n_cells), np.nan)
+        rows = np.full((len(percents), self.n_cells), -1, dtype=np.int64)
+        if not self._chunks or not percents:
+            return values, rows
+        samples = np.concatenate(self._chunks)
+        ranks = np.array([[_nearest_rank(pct, int(n)) for n in self.count] for pct in percents])
+        kth = np.unique(ranks[:, self.count > 0])
+        if len(kth) == 0:
+            return values, rows
+        order = np.argpartition(np.where(np.isnan(samples), np.inf, samples), kth, axis=0)
+        cells = np.broadcast_to(np.arange(self.n_cells), ranks.shape)
+        picked = order[ranks, cells]
+        filled = self.count > 0
+        rows[:, filled] = picked[:, filled]
+        values[:, filled] = samples[picked, cells][:, filled]
+        return values, rows
+
+    def quantiles(self, percents: List[float]) -> np.ndarray:
+        return self.conf_levels(percents)[0]
+
+    def sample_times(self, rows: np.ndarray) -> np.ndarray:
+        """Tags passed to add() for the given sample rows; NaN where untagged or row is -1."""
+        times = np.concatenate(self._times) if self._times else np.empty(0)
+        out = np.full(rows.shape, np.nan)
+        found = rows >= 0
+        out[found] = times[rows[found]]
+        return out
+
+
+class SketchAggregator:
+    """Bounded-memory quantile sketch per cell with an exact running mean.
+
+    Positive values fall into logarithmic buckets of ratio gamma = (1 + a) / (1 - a), so any
+    reported quantile is within relative error a of a true sample value (DDSketch-style).
+    Values at or below min_value are counted in a zero bucket, values above max_value are
+    clamped to the top bucket. Memory is O(cells) and independent of the number of samples,
+    and two sketches with the same settings merge by adding their counts.
+    """
+
+    def __init__(self, n_cells: int, relative_accuracy: float, min_value: float, max_value: float):
+        self.n_cells = n_cells
+        self.gamma = (1.0 + relative_accuracy) / (1.0 - relative_accuracy)
+        self._log_gamma = np.log(self.gamma)
+        self.min_value = min_value
+        self.k_min = int(np.ceil(np.log(min_value) / self._log_gamma))
+        self.k_max = int(np.ceil(np.log(max_value) / self._log_gamma))
+        self.count = np.zeros(n_cells, dtype=np.int64)
+        self.total = np.zeros(n_cells)
+        self.zeros = np.zeros(n_cells, dtype=np.int64)
+        self.buckets = np.zeros((n_cells, self.k_max - self.k_min + 1), dtype=np.int64)
+
+    def add(self, values: np.ndarray, t: Optional[np.ndarray] = None) -> None:
+        """Same as ExactAggregator.add; sample tags are not kept."""
+        values = np.asarray(values, dtype=float).reshape(-1, self.n_cells)
+        valid = ~np.isnan(values)
+        self.count += valid.sum(axis=0)
+        self.total += np.where(valid, values, 0.0).sum(axis=0)
+        small = valid & (values <= self.min_value)
+        self.zeros += small.sum(axis=0)
+        rows, cells = np.nonzero(valid & ~small)
+        k = np.ceil(np.log(values[rows, cells]) / self._log_gamma).astype(np.int64)
+        np.add.at(self.buckets, (cells, np.clip(k, self.k_min, self.k_max) - self.k_min), 1)
+
+    def merge(self, other: "SketchAggregator") -> "SketchAggregator":
+        if other.buckets.shape != self.buckets.shape or other.gamma != self.gamma:
+            raise ValueError("cannot merge sketches with different settings")
+        self.count += other.count
+        self.total += other.total
+        self.zeros += other.zeros
+        self.buckets += other.buckets
+        return self
+
+    def mean(self) -> np.ndarray:
+        return np.divide(self.total, self.count, out=np.full(self.n_cells, np.nan), where=self.count > 0)
+
+    def quantiles(self, percents: List[float]) -> np.ndarray:
+        out = np.full((len(percents), self.n_cells), np.nan)
+        for cell in range(self.n_cells):
+            n = int(self.count[cell])
+            if n == 0:
+                continue
+            cumulative = int(self.zeros[cell]) + np.cumsum(self.buckets[cell])
+            for row, pct in enumerate(percents):
+                rank = _nearest_rank(pct, n)
+                if rank < self.zeros[cell]:
+                    out[row, cell] = 0.0
+                    continue
+                k = self.k_min + int(np.searchsorted(cumulative, rank, side="right"))
+                out[row, cell] = 2.0 * self.gamma**k / (self.gamma + 1.0)
+        return out
+
+
+Aggregator = Union[ExactAggregator, SketchAggregator]
+
+
+def _nearest_rank(pct: float, n: int) -> int:
+    """0-based index of the nearest-rank pct-th percentile of n sorted samples."""
+    return min(max(int(np.ceil(pct / 100.0 * n)) - 1, 0), n - 1)
+
+
+class BoxcarFluence:
+    """Sliding-window (boxcar) fluence for several window lengths in one pass.
+
+    Flux samples taken every dt seconds are integrated into a compensated prefix sum per cell:
+    every row is added with TwoSum and its rounding error carried in a low-order float, across
+    chunks as well as within them, so each window sum is one subtraction of two prefix rows no
+    matter the window length. Window lengths must be whole multiples of dt. Only the last max-window prefix rows are kept.
+    Worst-to-date fluence and the time it ended are tracked in the same pass. NaN flux counts
+    as zero; windows longer than the data seen so far are not reported.
+    """
+
+    def __init__(self, n_cells: int, windows_sec: List[float], dt: float):
+        self.n_cells = n_cells
+        self.dt = float(dt)
+        self.windows = [int(round(w / self.dt)) for w in windows_sec]
+        for w, samples in zip(windows_sec, self.windows):
+            if samples < 1 or abs(samples * self.dt - w) > 1e-9 * max(w, 1.0):
+                raise ValueError(f"fluence window {w:g} s is not a positive multiple of the {self.dt:g} s step")
+        self._keep = max(self.windows)
+        self._hi = np.zeros((1, n_cells))
+        self._lo = np.zeros((1, n_cells))
+        self.seen = 0
+        self.worst = np.full((len(self.windows), n_cells), np.nan)
+        self.worst_t = np.full((len(self.windows), n_cells), np.nan)
+
+    def push(self, values: np.ndarray, t: np.ndarray) -> List[np.ndarray]:
+        """Add a [sample x cell] flux block; returns each window's fluence per sample (NaN until full)."""
+        values = np.asarray(values, dtype=float).reshape(-1, self.n_cells)
+        n = len(values)
+        terms = np.nan_to_num(values) * self.dt
+        hi = np.empty((n, self.n_cells))
+        lo = np.empty((n, self.n_cells))
+        s, c = self._hi[-1], self._lo[-1]
+        for r in range(n):
+            # TwoSum: s + a == total + err exactly; err accumulates in the low-order row.
+            a = terms[r]
+            total = s + a
+            b = total - s
+            c = c + ((s - (total - b)) + (a - b))
+            s = total
+            hi[r], lo[r] = s, c
+        all_hi = np.concatenate([self._hi, hi])
+        all_lo = np.concatenate([self._lo, lo])
+        offset = len(self._hi)
+        out = []
+        for k, w in enumerate(self.windows):
+            sums = np.full((n, self.n_cells), np.nan)
+            first = max(0, w - offset)
+            if first < n:
+                end = np.arange(first, n) + offset
+                sums[first:] = (all_hi[end] - all_hi[end - w]) + (all_lo[end] - all_lo[end - w])
+                self._update_worst(k, sums[first:], np.asarray(t, dtype=float)[first:])
+            out.append(sums)
+        self._hi = all_hi[-self._keep:]
+        self._lo = all_lo[-self._keep:]
+        self.seen += n
+        return out
+
+    def _update_worst(self, k: int, sums: np.ndarray, t: np.ndarray) -> None:
+        best = np.argmax(sums, axis=0)
+        peak = sums[best, np.arange(self.n_cells)]
+        better = ~(peak <= self.worst[k])
+        self.worst[k, better] = peak[better]
+        self.worst_t[k, better] = t[best[better]]
+
+
+class TreeReducer:
+    """Merges partial aggregations pairwise as they arrive.
+
+    Partials are combined like a binary counter: two partials of the same level merge into one
+    of the next level, so at most log2(n) partials are alive and every input takes part in
+    O(log n) merges, the same shape as a tree reduction across workers.
+    """
+
+    def __init__(self):
+        self._stack: List[Tuple[int, Aggregator]] = []
+
+    def push(self, part: Aggregator) -> None:
+        level = 0
+        while self._stack and self._stack[-1][0] == level:
+            _, left = self._stack.pop()
+            part = left.merge(part)
+            level += 1
+        self._stack.append((level, part))
+
+    def result(self) -> Optional[Aggregator]:
+        if not self._stack:
+            return None
+        _, acc = self._stack.pop()
+        while self._stack:
+            _, left = self._stack.pop()
+            acc = left.merge(acc)
+        return acc
+
+
+def tree_reduce(parts: Iterable[Aggregator]) -> Optional[Aggregator]:
+    reducer = TreeReducer()
+    for part in parts:
+        reducer.push(part)
+    return reducer.result()
+
+
+def make_aggregator(cfg: StatsConfig, n_cells: int) -> Aggregator:
+    if cfg.mode == "sketch":
+        return SketchAggregator(n_cells, cfg.relative_accuracy, cfg.min_value, cfg.max_value)
+    return ExactAggregator(n_cells)
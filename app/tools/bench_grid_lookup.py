@@ -0,0 +1,61 @@
+from __future__ import annotations
+
+import argparse
+import bisect
+import time
+from typing import Callable, Dict
+
+import numpy as np
+
+from app.services.flux_service import GridAxis, UniformGridAxis
+
+
+def _per_query_ns(fn: Callable[[], object], queries: int, repeat: int) -> float:
+    best = float("inf")
+    for _ in range(repeat):
+        start = time.perf_counter()
+        fn()
+        best = min(best, time.perf_counter() - start)
+    return best / queries * 1e9
+
+
+def run(nodes: int, queries: int, repeat: int, seed: int) -> Dict[str, Dict[str, float]]:
+    grid = list(np.linspace(-180.0, 180.0, nodes))
+    grid_arr = np.asarray(grid)
+    rng = np.random.default_rng(seed)
+    workloads = {
+        "random": rng.uniform(-180.0, 180.0, queries),
+        "track": ((np.arange(queries) * 0.25 + 180.0) % 360.0) - 180.0,
+    }
+    results: Dict[str, Dict[str, float]] = {}
+    for name, xs in workloads.items():
+        values = xs.tolist()
+        reuse = GridAxis(grid, reuse_cells=1)
+        uniform = UniformGridAxis(grid, reuse_cells=1)
+        results[name] = {
+            "bisect": _per_query_ns(lambda: [bisect.bisect_right(grid, x) for x in values], queries, repeat),
+            "bracket_reuse": _per_query_ns(lambda: [reuse.locate(x) for x in values], queries, repeat),
+            "uniform": _per_query_ns(lambda: [uniform.locate(x) for x in values], queries, repeat),
+            "searchsorted_batch": _per_query_ns(lambda: np.searchsorted(grid_arr, xs, side="right"), queries, repeat),
+            "uniform_batch": _per_query_ns(lambda: uniform.locate_many(xs), queries, repeat),
+        }
+    return results
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Per-query cost of grid bracket lookup")
+    parser.add_argument("--nodes", type=int, default=121, help="grid nodes on the axis")
+    parser.add_argument("--queries", type=int, default=200_000, help="queries per workload")
+    parser.add_argument("--repeat", type=int, default=5, help="timed repetitions (best is reported)")
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    for workload, timings in run(args.nodes, args.queries, args.repeat, args.seed).items():
+        print(f"{workload}:")
+        for method, ns in timings.items():
+            print(f"  {method:<20} {ns:10.1f} ns/query")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -36,3 +36,32 @@ def test_decision_thresholds():
     assert any(w.mode == "OBS_OFF" for w in windows)
     assert any(w.mode == "OBS_ON" for w in windows)
 
+
+def test_risk_array_matches_per_sample_formula():
+    cfg = DecisionConfig()
+    svc = DecisionService(cfg)
+    channels = ["Je>100keV", "Je>1MeV", "Jp>10MeV", "unknown"]
+    values = [[1e2, 5e1, 0.0, 3.0], [1e4, float("nan"), 2e1, 1.0]]
+    risk = svc.compute_risk_array(values, channels)
+    for row, got in zip(values, risk):
+        expected = sum(
+            cfg.risk_weights.get(ch, 0.0) * v ** cfg.risk_exponent for ch, v in zip(channels, row) if v > 0
+        )
+        assert abs(got - expected * cfg.risk_scale) <= 1e-12 * max(expected, 1.0)
+
+
+def test_risk_samples_match_series_path():
+    svc = DecisionService(DecisionConfig())
+    track = _track(3)
+    channels = ["Je>100keV", "Je>1MeV"]
+    values = [[1e2, 1e3], [float("nan"), float("nan")], [5e3, float("nan")]]
+    series = [
+        FluxSample(t=pt.t, channel=ch, value=v, percentile="mean")
+        for pt, row in zip(track, values)
+        for ch, v in zip(channels, row)
+        if v == v
+    ]
+    direct = svc.risk_samples(track, values, channels)
+    assert [r.t for r in direct] == [track[0].t, track[2].t]
+    for a, b in zip(direct, svc.compute_risk_series(series)):
+        assert a.t == b.t and abs(a.risk - b.risk) <= 1e-12 * max(a.risk, 1.0)
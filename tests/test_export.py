@@ -0,0 +1,27 @@
+import io
+import zipfile
+
+import numpy as np
+
+from app.services.export_service import FluxArchiveWriter, read_flux_window
+from app.services.flux_service import TrackColumns
+
+
+def test_archive_reads_back_time_window():
+    n = 100
+    cols = TrackColumns(t=np.arange(n) * 60.0, lat=np.linspace(-50, 50, n), lon=np.zeros(n), alt_km=np.full(n, 700.0))
+    values = np.stack([np.arange(n) * 1.0, np.arange(n) * 2.0], axis=1)
+    buf = io.BytesIO()
+    writer = FluxArchiveWriter(buf, ["Je>1MeV", "Jp>10MeV"], {"percentile": "mean"})
+    for start in range(0, n, 30):
+        writer.append(cols.slice(start, min(start + 30, n)), values[start : start + 30])
+    writer.close()
+
+    buf.seek(0)
+    window = read_flux_window(buf, 600.0, 2400.0, ["Jp>10MeV"])
+    assert np.array_equal(window["t"], np.arange(10, 41) * 60.0)
+    assert np.array_equal(window["Jp>10MeV"], np.arange(10, 41) * 2.0)
+    assert "Je>1MeV" not in window
+    buf.seek(0)
+    with zipfile.ZipFile(buf) as zf:
+        assert all(info.compress_type == zipfile.ZIP_DEFLATED for info in zf.infolist())
@@ -0,0 +1,299 @@
+import os
+import shutil
+import sys
+from datetime import datetime, timedelta, timezone
+
+import numpy as np
+
+from app.config import AE9AP9CLIConfig, AP8AE8Config, FluxConfig, FluxMockProfile
+from app.models import TrackPoint
+from app.services.flux_service import (
+    AE9AP9Model,
+    AP8AE8Model,
+    FluxGridTable,
+    FluxService,
+    GridAxis,
+    MockFluxModel,
+    PointFluxCache,
+    SegmentCostModel,
+    TrackColumns,
+    UniformGridAxis,
+    _spenvis_grids,
+    counter_normal,
+    is_resumable_segment,
+    make_grid_axis,
+)
+
+
+def _track(n=6):
+    t0 = datetime(2025, 1, 1, tzinfo=timezone.utc)
+    return [
+        TrackPoint(
+            t=t0 + timedelta(seconds=60 * i),
+            lat=10.0 * i,
+            lon=-20.0 * i,
+            alt_km=700.0 + 100.0 * i,
+            tle_epoch=t0,
+            orbit_quality=1.0,
+        )
+        for i in range(n)
+    ]
+
+
+def test_flux_into_matches_per_point():
+    model = MockFluxModel(FluxMockProfile())
+    track = _track()
+    out = np.empty((len(track), len(model.channels)))
+    model.flux_into(TrackColumns.from_points(track), "mean", out)
+    for row, pt in zip(out, track):
+        expected = model.flux(pt, "mean")
+        assert [expected[ch] for ch in model.channels] == row.tolist()
+
+
+def test_compute_series_from_columns():
+    svc = FluxService(FluxConfig(model="mock"))
+    track = _track()
+    series = svc.compute_series(track, "mean")
+    assert len(series) == len(track) * len(svc.model.channels)
+    assert series[0].channel == "Je>100keV"
+
+
+def test_compute_series_many_matches_single_percentiles():
+    svc = FluxService(FluxConfig(model="mock", percentile_workers=2))
+    track = _track()
+    series = svc.compute_series_many(track, ["mean", "p95"])
+    assert series == svc.compute_series(track, "mean") + svc.compute_series(track, "p95")
+
+
+def test_ap8ae8_sparse_weights_match_point_interpolation():
+    model = AP8AE8Model(AP8AE8Config(compiled_cache_dir=""))
+    rng = np.random.default_rng(1)
+    n = 200
+    lat = np.concatenate([rng.uniform(-95.0, 95.0, n), [-90.0, 90.0, 0.0]])
+    lon = np.concatenate([rng.uniform(-400.0, 400.0, n), [180.0, -180.0, 540.0]])
+    cols = TrackColumns(t=np.zeros(len(lat)), lat=lat, lon=lon, alt_km=np.full(len(lat), 550.0))
+    out = np.empty((len(cols), 1))
+    model.flux_into(cols, "mean", out)
+    expected = [model._interp_flux(float(a), float(b)) for a, b in zip(lat, lon)]
+    assert np.allclose(out[:, 0], expected, rtol=1e-12, atol=1e-12 * max(expected))
+
+
+def test_grid_axis_reuses_previous_bracket():
+    nodes = [-90.0, -60.0, -30.0, 0.0, 30.0, 60.0, 90.0]
+    axis = GridAxis(nodes, reuse_cells=1)
+    queries = [-89.0, -85.0, -61.0, -59.0, 45.0, 46.0, 90.0, -90.0]
+    for x in queries:
+        assert axis.locate(x) == int(np.searchsorted(nodes, x, side="right"))
+    assert axis.hits == 4
+    assert axis.misses == 4
+    batch = GridAxis(nodes, reuse_cells=1)
+    assert np.array_equal(batch.locate_many(np.array(queries)), np.searchsorted(nodes, queries, side="right"))
+    assert batch.stats() == {"hits": 0, "misses": 0, "searched": len(queries)}
+
+
+def test_counter_rng_is_order_independent():
+    stamps = np.arange(1.7e9, 1.7e9 + 4000.0, 1.0)
+    draws = counter_normal(42, stamps)
+    assert np.array_equal(draws[::-1], counter_normal(42, stamps[::-1]))
+    assert draws[1234] == counter_normal(42, stamps[1234:1235])[0]
+    assert not np.array_equal(draws, counter_normal(43, stamps))
+    assert abs(draws.mean()) < 0.1 and abs(draws.std() - 1.0) < 0.1
+
+
+def test_uniform_axis_matches_searchsorted():
+    nodes = list(np.arange(-180.0, 180.0 + 1e-9, 3.0))
+    axis = make_grid_axis(nodes, reuse_cells=1)
+    assert isinstance(axis, UniformGridAxis)
+    xs = np.concatenate([nodes, np.nextafter(nodes, -np.inf), np.random.default_rng(0).uniform(-200.0, 200.0, 500)])
+    expected = np.searchsorted(nodes, xs, side="right")
+    assert np.array_equal(axis.locate_many(xs), expected)
+    assert [axis.locate(float(x)) for x in xs] == expected.tolist()
+    assert axis.stats() == {"hits": 0, "misses": 0, "searched": 0, "arithmetic": 2 * len(xs)}
+    assert not isinstance(make_grid_axis([0.0, 1.0, 3.0, 7.0], 1), UniformGridAxis)
+
+
+_FAKE_CLI = """
+import json, sys
+from pathlib import Path
+payload = json.loads(Path(sys.argv[1]).read_text())
+calls = Path(sys.argv[3])
+calls.write_text(calls.read_text() + "x" if calls.exists() else "x")
+points = [
+    {"values": {ch: p["alt_km"] * (k + 1) + p["lat"] for k, ch in enumerate(payload["channels"])}}
+    for p in payload["points"]
+]
+Path(sys.argv[2]).write_text(json.dumps({"points": points}))
+"""
+
+
+def _fake_cli_config(tmp_path, name="cache", **overrides):
+    script = tmp_path / "fake_cli.py"
+    script.write_text(_FAKE_CLI)
+    calls = tmp_path / f"{name}_calls.txt"
+    cfg = AE9AP9CLIConfig(
+        executable=sys.executable,
+        command_template=f'"{{exe}}" "{script}" "{{input}}" "{{output}}" "{calls}"',
+        cache_dir=str(tmp_path / name),
+        **overrides,
+    )
+    return cfg, calls
+
+
+def test_ae9ap9_binary_cache_skips_cli(tmp_path):
+    cfg, calls = _fake_cli_config(tmp_path, max_points_per_call=4)
+    model = AE9AP9Model(cfg, ["Je>1MeV", "Jp>10MeV"])
+    cols = TrackColumns.from_points(_track())
+    first = model.flux_array(cols, "mean")
+    second = model.flux_array(cols, "mean")
+    assert np.array_equal(first, second)
+    assert np.array_equal(first[:, 1], 2.0 * cols.alt_km + cols.lat)
+    assert calls.read_text() == "xx"
+    segments = sorted((tmp_path / "cache").glob("*.npy"))
+    assert len(segments) == 2
+    assert len(list((tmp_path / "cache").glob("*.done"))) == 2
+    assert not list((tmp_path / "cache").glob("*.json"))
+    mapped = AE9AP9Model(cfg.model_copy(update={"cache_verify": False}), ["Je>1MeV", "Jp>10MeV"])
+    assert np.array_equal(mapped.flux_array(cols, "mean"), first)
+    assert calls.read_text() == "xx"
+    resume_cfg = cfg.model_copy(update={"cache_resume": True})
+    assert all(is_resumable_segment(resume_cfg, p) for p in (tmp_path / "cache").glob("*"))
+    assert not any(is_resumable_segment(cfg, p) for p in (tmp_path / "cache").glob("*"))
+    segments[0].write_bytes(segments[0].read_bytes()[:-8] + b"corrupt!")
+    assert np.array_equal(model.flux_array(cols, "mean"), first)
+    assert calls.read_text() == "xxx"
+    segments[1].with_suffix(".done").unlink()
+    assert np.array_equal(model.flux_array(cols, "mean"), first)
+    assert calls.read_text() == "xxxx"
+    assert segments[1].exists() and segments[1].with_suffix(".done").exists()
+
+
+def test_ae9ap9_workers_match_serial(tmp_path):
+    cols = TrackColumns.from_points(_track(12))
+    channels = ["Je>1MeV", "Jp>10MeV"]
+    serial_cfg, _ = _fake_cli_config(tmp_path, name="serial", max_points_per_call=2)
+    parallel_cfg, calls = _fake_cli_config(tmp_path, name="parallel", max_points_per_call=2, workers=3)
+    serial = AE9AP9Model(serial_cfg, channels).flux_array(cols, "mean")
+    parallel = AE9AP9Model(parallel_cfg, channels).flux_array(cols, "mean")
+    assert np.array_equal(serial, parallel)
+    assert calls.read_text() == "x" * 6
+
+
+def test_segment_cost_model_learns_band_rates():
+    model = SegmentCostModel(band_km=500.0)
+    leo, geo = np.full(10, 700.0), np.full(10, 35786.0)
+    assert model.estimate(leo) == model.estimate(geo) == 10.0
+    model.observe(leo, seconds=2.0, estimate=10.0)
+    model.observe(geo, seconds=0.2, estimate=10.0)
+    assert model.estimate(leo) > model.estimate(geo)
+    assert len(model.timings) == 2
+
+
+def test_ae9ap9_scheduled_segments_match_serial(tmp_path):
+    cols = TrackColumns.from_points(_track(8))
+    channels = ["Je>1MeV", "Jp>10MeV"]
+    serial_cfg, _ = _fake_cli_config(tmp_path, name="serial")
+    scheduled_cfg, calls = _fake_cli_config(tmp_path, name="scheduled", workers=2, schedule_segment_points=2)
+    serial = AE9AP9Model(serial_cfg, channels).flux_array(cols, "mean")
+    model = AE9AP9Model(scheduled_cfg, channels)
+    assert np.array_equal(model.flux_array(cols, "mean"), serial)
+    assert len(model.cost_model.timings) == 4
+    assert calls.read_text() == "x" * 4
+    assert np.array_equal(model.flux_array(cols, "mean"), serial)
+    assert len(model.cost_model.timings) == 4
+
+
+def test_point_cache_hits_evicts_and_persists(tmp_path):
+    path = tmp_path / "points.json"
+    cache = PointFluxCache(3600, 0.01, 1.0, max_entries=4, path=str(path), ttl_sec=3600, signature="a")
+    keys = cache.point_keys(TrackColumns.from_points(_track(4)))
+    channels = ["Je>1MeV", "Jp>10MeV"]
+    cache.store(keys[1:3], "mean", channels, np.arange(4.0).reshape(2, 2))
+    out = np.full((4, 2), np.nan)
+    assert cache.lookup(keys, "mean", channels, out).tolist() == [False, True, True, False]
+    assert out[1].tolist() == [0.0, 1.0] and np.isnan(out[0]).all()
+    assert not cache.lookup(keys[1:2], "p95", channels, out[:1]).any()
+    cache.store(keys[3:], "mean", channels, np.array([[6.0, 7.0]]))
+    assert cache.lookup(keys, "mean", channels, out).tolist() == [False, False, True, True]
+
+    assert not path.exists()
+    cache.flush()
+    assert path.exists() and not list(tmp_path.glob("*.tmp"))
+    reloaded = PointFluxCache(3600, 0.01, 1.0, max_entries=4, path=str(path), ttl_sec=3600, signature="a")
+    assert reloaded.lookup(keys[2:], "mean", channels, np.empty((2, 2))).all()
+    other_cli = PointFluxCache(3600, 0.01, 1.0, max_entries=4, path=str(path), ttl_sec=3600, signature="b")
+    assert not other_cli.lookup(keys[2:], "mean", channels, np.empty((2, 2))).any()
+    expired = PointFluxCache(3600, 0.01, 1.0, max_entries=4, path=str(path), ttl_sec=3600, signature="a")
+    expired._entries = type(expired._entries)((k, (v, t - 7200.0)) for k, (v, t) in expired._entries.items())
+    assert not expired.lookup(keys[2:], "mean", channels, np.empty((2, 2))).any()
+
+
+def test_grid_table_interpolates_model_at_nodes_and_midpoints():
+    model = MockFluxModel(FluxMockProfile())
+    cfg = AE9AP9CLIConfig(grid_lat_step_deg=30.0, grid_lon_step_deg=60.0, grid_alt_layers_km=[850.0, 1000.0, 1150.0])
+    t = datetime(2025, 1, 1, tzinfo=timezone.utc)
+    table = FluxGridTable.build(model, t, "mean", cfg)
+    alt, lat, lon = np.meshgrid(table.altitudes, table.latitudes, table.longitudes, indexing="ij")
+    nodes = TrackColumns(t=np.full(alt.size, t.timestamp()), lat=lat.ravel(), lon=lon.ravel(), alt_km=alt.ravel())
+    assert np.array_equal(table.interpolate(nodes), model.flux_array(nodes, "mean"))
+    mids = TrackColumns(
+        t=np.full(3, t.timestamp()), lat=np.array([15.0, -45.0, 75.0]), lon=np.array([30.0, -150.0, 90.0]),
+        alt_km=np.array([925.0, 1075.0, 900.0]),
+    )
+    assert np.allclose(table.interpolate(mids), model.flux_array(mids, "mean"), rtol=1e-12)
+    assert table.max_rel_err < 1e-12
+
+
+def test_grid_table_budget_and_altitude_fallback(tmp_path):
+    cli, calls = _fake_cli_config(
+        tmp_path,
+        grid_table_enabled=True,
+        grid_lookup_rel_err=1e-6,
+        grid_lat_step_deg=30.0,
+        grid_lon_step_deg=60.0,
+        grid_alt_layers_km=[600.0, 900.0],
+    )
+    svc = FluxService(FluxConfig(model="ae9ap9", energy_channels=["Je>1MeV", "Jp>10MeV"], ae9ap9=cli))
+    geo = _track(3)
+    for pt in geo:
+        pt.alt_km = 35786.0
+    geo_cols = TrackColumns.from_points(geo)
+    assert np.array_equal(svc.flux_values(geo_cols, "mean")[:, 0], geo_cols.alt_km + geo_cols.lat)
+    assert calls.read_text() == "x"
+
+    leo = TrackColumns.from_points(_track(3))
+    expected = np.stack([leo.alt_km + leo.lat, 2.0 * leo.alt_km + leo.lat], axis=1)
+    assert np.allclose(svc.flux_values(leo, "mean"), expected, rtol=1e-12)
+    built = len(calls.read_text())
+    assert built > 1
+
+    table = svc._grid_table(datetime.fromtimestamp(float(leo.t[0]) // 3600 * 3600, tz=timezone.utc), "mean")
+    table.max_rel_err = 1.0
+    assert np.array_equal(svc.flux_values(leo, "mean"), expected)
+    assert len(calls.read_text()) == built + 1
+
+
+def test_ap8ae8_compiled_grid_is_shared_and_invalidated(tmp_path):
+    for name in ("spenvis_pos.txt", "spenvis_tpo.txt"):
+        shutil.copy(name, tmp_path / name)
+    cfg = AP8AE8Config(
+        pos_path=str(tmp_path / "spenvis_pos.txt"),
+        flux_path=str(tmp_path / "spenvis_tpo.txt"),
+        compiled_cache_dir=str(tmp_path / "compiled"),
+    )
+    first = AP8AE8Model(cfg)
+    assert len(list((tmp_path / "compiled").glob("*.npy"))) == 3
+    assert not list((tmp_path / "compiled").glob("*.tmp"))
+    assert AP8AE8Model(cfg).grid is first.grid
+
+    for key in [k for k in _spenvis_grids if k[1] == cfg.compiled_cache_dir]:
+        del _spenvis_grids[key]
+    mapped = AP8AE8Model(cfg)
+    assert isinstance(mapped.grid, np.memmap) and not mapped.grid.flags.writeable
+    assert np.array_equal(mapped.grid, first.grid)
+
+    st = os.stat(cfg.flux_path)
+    os.utime(cfg.flux_path, ns=(st.st_atime_ns, st.st_mtime_ns + 1_000_000_000))
+    changed = AP8AE8Model(cfg)
+    assert changed.grid is not mapped.grid
+    assert np.array_equal(mapped.grid, first.grid)
+    assert len(list((tmp_path / "compiled").glob("*.npy"))) == 3
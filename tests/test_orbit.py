@@ -0,0 +1,59 @@
+from datetime import datetime, timedelta, timezone
+
+import pytest
+
+from app.config import OrbitConfig
+from app.models import TLESet
+from app.services.orbit_service import OrbitService
+
+
+def _tle(line1, line2):
+    t0 = datetime(2025, 1, 5, tzinfo=timezone.utc)
+    return TLESet(norad_id=int(line1[2:7]), source="test", fetched_at=t0, epoch=t0, line1=line1, line2=line2, score=1.0)
+
+
+ISS = _tle(
+    "1 25544U 98067A   25005.51000000  .00016717  00000+0  10270-3 0  9991",
+    "2 25544  51.6428  43.5905 0006786 306.3418  53.6891 15.50355749442124",
+)
+
+
+def test_track_many_matches_single_track():
+    svc = OrbitService(OrbitConfig())
+    start = datetime(2025, 1, 5, 12, tzinfo=timezone.utc)
+    end = start + timedelta(minutes=30)
+    tracks = svc.track_many([ISS, ISS], start, end, 60)
+    single = svc.track(ISS, start, end, 60)
+    assert len(tracks) == 2
+    assert [p.t for p in tracks[1]] == [p.t for p in single]
+    assert [(p.lat, p.lon, p.alt_km) for p in tracks[1]] == [(p.lat, p.lon, p.alt_km) for p in single]
+
+
+def test_iter_track_chunks_cover_track():
+    svc = OrbitService(OrbitConfig())
+    start = datetime(2025, 1, 5, 12, tzinfo=timezone.utc)
+    end = start + timedelta(minutes=25)
+    chunks = list(svc.iter_track(ISS, start, end, 60, chunk_points=7))
+    assert [p.t for chunk in chunks for p in chunk] == [p.t for p in svc.track(ISS, start, end, 60)]
+
+
+def test_batch_transform_matches_scalar_path():
+    start = datetime(2025, 1, 5, 12, tzinfo=timezone.utc)
+    end = start + timedelta(minutes=90)
+    batch = OrbitService(OrbitConfig(batch_transform=True)).track(ISS, start, end, 300)
+    scalar = OrbitService(OrbitConfig(batch_transform=False)).track(ISS, start, end, 300)
+    assert [p.t for p in batch] == [p.t for p in scalar]
+    # The batch path rotates by GMST only; pymap3d's eci2ecef may also apply precession/nutation
+    # (about 0.35 deg in longitude since J2000), so compare within that margin.
+    for b, s in zip(batch, scalar):
+        assert abs(b.lat - s.lat) < 0.5
+        assert abs((b.lon - s.lon + 180.0) % 360.0 - 180.0) < 0.5
+        assert abs(b.alt_km - s.alt_km) < 5.0
+
+
+def test_track_many_fails_batch_on_sgp4_error():
+    # 20 rev/day puts the semi-major axis below 0.95 Earth radii, which SGP4 rejects.
+    bad = _tle(ISS.line1.replace("25544U", "99999U"), ISS.line2.replace("15.50355749", "20.00000000"))
+    start = datetime(2025, 1, 5, 12, tzinfo=timezone.utc)
+    with pytest.raises(RuntimeError, match="NORAD 99999"):
+        OrbitService(OrbitConfig()).track_many([ISS, bad], start, start + timedelta(minutes=10), 60)
@@ -0,0 +1,47 @@
+import threading
+import time
+
+import pytest
+
+from app.services.pipeline import staged
+
+
+def test_staged_keeps_order():
+    out = list(staged(range(50), lambda x: x * 2, lambda x: x + 1, maxsize=1))
+    assert out == [2 * x + 1 for x in range(50)]
+
+
+def test_stage_exception_reaches_consumer():
+    def boom(x):
+        if x == 3:
+            raise ValueError("bad chunk")
+        return x
+
+    seen = []
+    with pytest.raises(ValueError, match="bad chunk"):
+        for item in staged(range(10), boom, maxsize=1):
+            seen.append(item)
+    assert seen == [0, 1, 2]
+
+
+def test_early_exit_stops_upstream_threads():
+    closed = threading.Event()
+
+    def source():
+        try:
+            i = 0
+            while True:
+                yield i
+                i += 1
+        finally:
+            closed.set()
+
+    before = threading.active_count()
+    items = staged(source(), lambda x: x, lambda x: x, maxsize=1)
+    assert [next(items) for _ in range(3)] == [0, 1, 2]
+    items.close()
+    assert closed.wait(5.0)
+    deadline = time.monotonic() + 5.0
+    while threading.active_count() > before and time.monotonic() < deadline:
+        time.sleep(0.05)
+    assert threading.active_count() == before
@@ -0,0 +1,105 @@
+import numpy as np
+import pytest
+from pydantic import ValidationError
+
+from app.config import StatsConfig
+from app.services.stats_service import BoxcarFluence, ExactAggregator, SketchAggregator, TreeReducer, tree_reduce
+
+
+def test_sketch_matches_exact_within_relative_accuracy():
+    rng = np.random.default_rng(7)
+    values = rng.lognormal(mean=5.0, sigma=2.0, size=(5000, 3))
+    values[::97, 1] = np.nan
+    exact, sketch = ExactAggregator(3), SketchAggregator(3, 0.01, 1e-10, 1e15)
+    for chunk in np.array_split(values, 7):
+        exact.add(chunk)
+        sketch.add(chunk)
+    percents = [1.0, 50.0, 90.0, 99.0]
+    ref = exact.quantiles(percents)
+    assert np.all(np.abs(sketch.quantiles(percents) - ref) <= 0.01 * ref)
+    assert exact.count.tolist() == sketch.count.tolist()
+    assert np.allclose(exact.mean(), np.nanmean(values, axis=0))
+
+
+def test_sketches_merge_like_one_pass():
+    rng = np.random.default_rng(3)
+    values = rng.lognormal(size=(1000, 2))
+    whole = SketchAggregator(2, 0.02, 1e-10, 1e15)
+    whole.add(values)
+    left, right = SketchAggregator(2, 0.02, 1e-10, 1e15), SketchAggregator(2, 0.02, 1e-10, 1e15)
+    left.add(values[:400])
+    right.add(values[400:])
+    merged = left.merge(right)
+    assert np.array_equal(merged.buckets, whole.buckets)
+    assert np.array_equal(merged.quantiles([50.0, 95.0]), whole.quantiles([50.0, 95.0]))
+
+
+def test_conf_levels_select_sample_rows():
+    rng = np.random.default_rng(11)
+    values = rng.normal(size=(301, 2))
+    values[5, 0] = np.nan
+    agg = ExactAggregator(2)
+    agg.add(values[:150], t=np.arange(150.0))
+    agg.add(values[150:], t=np.arange(150.0, 301.0))
+    percents = [50.0, 75.0, 90.0, 95.0, 99.0]
+    levels, rows = agg.conf_levels(percents)
+    for cell in range(2):
+        column = np.sort(values[~np.isnan(values[:, cell]), cell])
+        for row, pct in enumerate(percents):
+            rank = int(np.ceil(pct / 100.0 * len(column))) - 1
+            assert levels[row, cell] == column[rank]
+            assert values[rows[row, cell], cell] == levels[row, cell]
+    assert np.array_equal(agg.sample_times(rows), rows.astype(float))
+
+
+def test_tree_reduce_matches_single_pass():
+    rng = np.random.default_rng(5)
+    values = rng.lognormal(size=(700, 2))
+    whole = ExactAggregator(2)
+    whole.add(values)
+    parts = []
+    for chunk in np.array_split(values, 11):
+        part = ExactAggregator(2)
+        part.add(chunk)
+        parts.append(part)
+    merged = tree_reduce(parts)
+    assert merged.count.tolist() == whole.count.tolist()
+    assert np.allclose(merged.mean(), whole.mean())
+    assert np.array_equal(merged.quantiles([10.0, 50.0, 99.0]), whole.quantiles([10.0, 50.0, 99.0]))
+    reducer = TreeReducer()
+    for _ in range(16):
+        reducer.push(SketchAggregator(1, 0.05, 1e-10, 1e15))
+    assert len(reducer._stack) == 1
+
+
+def test_boxcar_fluence_matches_direct_window_sums():
+    rng = np.random.default_rng(2)
+    values = rng.lognormal(size=(250, 2))
+    t = np.arange(250) * 60.0
+    boxcar = BoxcarFluence(2, [60.0 * 5, 60.0 * 40], dt=60.0)
+    series = [[], []]
+    for idx in np.array_split(np.arange(250), 9):
+        for k, sums in enumerate(boxcar.push(values[idx], t[idx])):
+            series[k].append(sums)
+    for k, w in enumerate([5, 40]):
+        got = np.concatenate(series[k])
+        assert np.isnan(got[: w - 1]).all()
+        direct = np.array([values[i - w + 1 : i + 1].sum(axis=0) * 60.0 for i in range(w - 1, 250)])
+        assert np.allclose(got[w - 1 :], direct)
+        assert np.allclose(boxcar.worst[k], direct.max(axis=0))
+        assert np.array_equal(boxcar.worst_t[k], t[direct.argmax(axis=0) + w - 1])
+    with pytest.raises(ValueError, match="multiple"):
+        BoxcarFluence(2, [90.0], dt=60.0)
+
+
+def test_boxcar_fluence_compensates_within_chunks():
+    values = np.array([[1e16], [1.0], [1.0], [1.0], [-1e16], [1.0]])
+    (full,) = BoxcarFluence(1, [6.0], dt=1.0).push(values, np.arange(6.0))
+    assert full[-1, 0] == 4.0  # a plain cumulative sum loses the three middle 1.0s and gives 1.0
+
+
+def test_stats_config_rejects_bad_sketch_range():
+    with pytest.raises(ValidationError, match="min_value must be positive"):
+        StatsConfig(min_value=0.0)
+    with pytest.raises(ValidationError, match="greater than stats.min_value"):
+        StatsConfig(min_value=1.0, max_value=1.0)